@@ -0,0 +1,1419 @@
+#include <fcntl.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "libstring.h"
+
+#define IDENT 40
+#define MIN_TIME 0.25
+#define MiB (1024 * 1024)
+
+static volatile size_t sink;
+
+/***********************************************************************/
+/***********************************************************************/
+
+static double now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/***********************************************************************/
+
+static void report(const char *name, size_t bytes, double secs) {
+  printf("Bench %s: %*s%9.3f GB/s\n", name, (int)(IDENT - strlen(name)), "",
+         bytes / secs / 1e9);
+}
+
+static void report_ops(const char *name, size_t ops, double secs) {
+  printf("Bench %s: %*s%9.0f op/s\n", name, (int)(IDENT - strlen(name)), "",
+         ops / secs);
+}
+
+/*
+ * Runs `expr` until at least MIN_TIME seconds have passed and hands
+ * `amount` times the number of runs to `reporter`.
+ */
+#define MEASURE(reporter, name, amount, expr)                                  \
+  do {                                                                         \
+    size_t rounds = 0;                                                         \
+    double start = now();                                                      \
+    do {                                                                       \
+      sink += (size_t)(expr);                                                  \
+      rounds += 1;                                                             \
+    } while (now() - start < MIN_TIME);                                        \
+    reporter(name, (amount) * rounds, now() - start);                          \
+  } while (0)
+
+/* Reports throughput, assuming every run touches `bytes` bytes of input. */
+#define BENCH(name, bytes, expr) MEASURE(report, name, bytes, expr)
+
+/* Reports operations per second, assuming every run performs `ops`. */
+#define BENCH_OPS(name, ops, expr) MEASURE(report_ops, name, ops, expr)
+
+/***********************************************************************/
+
+static string_t *string_alloc(size_t len) {
+  string_t *s = malloc(sizeof(string_t) + len);
+  s->len = len;
+  return s;
+}
+
+/***********************************************************************/
+
+/* Generates lowercase words separated by blanks and newlines. */
+static string_t *random_text(size_t len) {
+  string_t *s = string_alloc(len);
+  srand(42);
+  for (size_t i = 0; i < len; i++) {
+    int r = rand() % 64;
+    s->buf[i] = (r < 52) ? 'a' + r % 26 : (r < 62) ? ' ' : '\n';
+  }
+  return s;
+}
+
+/***********************************************************************/
+/***********************************************************************/
+
+/* The byte-by-byte search libstring used before the Two-Way engine. */
+static int naive_index(const string_t *str, const string_t *substring) {
+  if (substring->len == 0)
+    return 0;
+  if (substring->len > str->len)
+    return -1;
+
+  for (size_t i = 0; i <= str->len - substring->len; i++) {
+    for (size_t j = 0; j < substring->len; j++) {
+      if (str->buf[i + j] != substring->buf[j])
+        break;
+      if ((j + 1) == substring->len)
+        return i;
+    }
+  }
+  return -1;
+}
+
+/***********************************************************************/
+
+void bench_search() {
+  string_t *text = random_text(16 * MiB);
+  string_t *n20 = string_new("GET /api/v1/status 2");
+  string_t *n60 = string_new(
+      "2024-01-01T00:00:00Z ERROR connection reset by peer (code 104)");
+
+  BENCH("search naive, 20 byte needle", text->len, naive_index(text, n20));
+  BENCH("search, 20 byte needle", text->len,
+        string_substring_index(text, n20));
+  BENCH("search naive, 60 byte needle", text->len, naive_index(text, n60));
+  BENCH("search, 60 byte needle", text->len,
+        string_substring_index(text, n60));
+
+  string_t *a = string_new("a");
+  string_t *hay = string_repeat(a, 4 * MiB);
+  string_t *half = string_repeat(a, 30);
+  string_t *b = string_new("b");
+  string_t *t = string_concat(half, b);
+  string_t *worst = string_concat(t, half);
+
+  BENCH("search naive, a^30ba^30 in a^n", hay->len, naive_index(hay, worst));
+  BENCH("search, a^30ba^30 in a^n", hay->len,
+        string_substring_index(hay, worst));
+
+  free(a);
+  free(b);
+  free(hay);
+  free(half);
+  free(t);
+  free(worst);
+  free(text);
+  free(n20);
+  free(n60);
+}
+
+/***********************************************************************/
+
+#define RECORDS 100000
+#define RECORD_LEN 160
+
+static size_t search_records(string_t **records, const string_t *needle) {
+  size_t hits = 0;
+  for (size_t i = 0; i < RECORDS; i++)
+    hits += string_substring_index(records[i], needle) >= 0;
+  return hits;
+}
+
+static size_t needle_records(string_t **records, const string_needle_t *n) {
+  size_t hits = 0;
+  for (size_t i = 0; i < RECORDS; i++)
+    hits += string_needle_find(n, records[i]) >= 0;
+  return hits;
+}
+
+void bench_needle() {
+  string_t *text = random_text(RECORDS * RECORD_LEN);
+  string_t **records = malloc(RECORDS * sizeof(string_t *));
+  for (size_t i = 0; i < RECORDS; i++) {
+    records[i] = string_alloc(RECORD_LEN);
+    memcpy(records[i]->buf, text->buf + i * RECORD_LEN, RECORD_LEN);
+  }
+  string_t *str = string_new("user_id=");
+  string_needle_t *needle = string_needle_new(str);
+
+  BENCH("search records", text->len, search_records(records, str));
+  BENCH("search records, compiled needle", text->len,
+        needle_records(records, needle));
+  BENCH("count, compiled needle", text->len, string_needle_count(needle, text));
+
+  for (size_t i = 0; i < RECORDS; i++)
+    free(records[i]);
+  free(records);
+  free(needle);
+  free(str);
+  free(text);
+}
+
+/***********************************************************************/
+
+#define KEYWORDS 200
+
+static size_t keyword_loop(string_t **records, const string_vector_t *kw) {
+  size_t hits = 0;
+  for (size_t i = 0; i < RECORDS; i++)
+    for (size_t k = 0; k < string_vector_len(kw); k++)
+      hits += string_substring_index(records[i], kw->buf[k]) >= 0;
+  return hits;
+}
+
+static size_t matcher_records(string_t **records, const string_matcher_t *mt) {
+  size_t hits = 0, n;
+  for (size_t i = 0; i < RECORDS; i++) {
+    free(string_matcher_find_all(mt, records[i], &n));
+    hits += n;
+  }
+  return hits;
+}
+
+void bench_matcher() {
+  string_t *text = random_text(RECORDS * RECORD_LEN);
+  string_t **records = malloc(RECORDS * sizeof(string_t *));
+  for (size_t i = 0; i < RECORDS; i++) {
+    records[i] = string_alloc(RECORD_LEN);
+    memcpy(records[i]->buf, text->buf + i * RECORD_LEN, RECORD_LEN);
+  }
+  string_vector_t *kw = string_vector_empty();
+  for (size_t k = 0; k < KEYWORDS; k++) {
+    string_t *w = string_alloc(5 + k % 8);
+    for (size_t j = 0; j < w->len; j++)
+      w->buf[j] = 'a' + rand() % 26;
+    string_vector_add(kw, w);
+  }
+  string_matcher_t *mt = string_matcher_new(kw);
+
+  BENCH("200 keywords, per-keyword loop", text->len,
+        keyword_loop(records, kw));
+  BENCH("200 keywords, matcher", text->len, matcher_records(records, mt));
+
+  for (size_t i = 0; i < RECORDS; i++)
+    free(records[i]);
+  free(records);
+  string_matcher_free(mt);
+  string_vector_deepfree(kw);
+  free(text);
+}
+
+/***********************************************************************/
+
+static size_t replace_one(const string_t *text, const string_t *old,
+                          const string_t *new) {
+  string_t *s = string_replace(text, old, new);
+  size_t len = s->len;
+  free(s);
+  return len;
+}
+
+static size_t replace_chain(const string_t *text, const string_vector_t *old,
+                            const string_vector_t *new) {
+  string_t *s = string_clone(text);
+  for (size_t i = 0; i < string_vector_len(old); i++) {
+    string_t *t = string_replace(s, old->buf[i], new->buf[i]);
+    free(s);
+    s = t;
+  }
+  size_t len = s->len;
+  free(s);
+  return len;
+}
+
+static size_t replace_many(const string_t *text, const string_vector_t *old,
+                           const string_vector_t *new) {
+  string_t *s = string_replace_many(text, old, new);
+  size_t len = s->len;
+  free(s);
+  return len;
+}
+
+void bench_replace() {
+  static const char *pairs[][2] = {{"&", "&amp;"},  {"<", "&lt;"},
+                                   {">", "&gt;"},   {"\"", "&quot;"},
+                                   {"'", "&#39;"},  {"\n", "<br>"}};
+  string_t *text = random_text(16 * MiB);
+  string_t *old = string_new("\n");
+  string_t *new = string_new("\r\n");
+  string_vector_t *ovec = string_vector_empty();
+  string_vector_t *nvec = string_vector_empty();
+  for (size_t i = 0; i < sizeof(pairs) / sizeof(pairs[0]); i++) {
+    string_vector_add(ovec, string_new(pairs[i][0]));
+    string_vector_add(nvec, string_new(pairs[i][1]));
+  }
+
+  BENCH("replace \\n with \\r\\n", text->len, replace_one(text, old, new));
+  BENCH("replace 6 pairs, chained", text->len,
+        replace_chain(text, ovec, nvec));
+  BENCH("replace 6 pairs, string_replace_many", text->len,
+        replace_many(text, ovec, nvec));
+
+  string_vector_deepfree(ovec);
+  string_vector_deepfree(nvec);
+  free(old);
+  free(new);
+  free(text);
+}
+
+/***********************************************************************/
+
+static size_t trim_len(const string_t *str) {
+  string_t *s = string_trim(str);
+  size_t len = s->len;
+  free(s);
+  return len;
+}
+
+static size_t replace_char_len(const string_t *str) {
+  string_t *s = string_replace_char(str, ' ', '_');
+  size_t len = s->len;
+  free(s);
+  return len;
+}
+
+/* Runs the character kernels at every instruction set level available. */
+void bench_chars() {
+  static const char *names[] = {"scalar", "sse2", "avx2", "avx512"};
+  string_t *text = random_text(16 * MiB);
+  string_t *set = string_new("<>&");
+  string_t *padded = string_alloc(2 * MiB + 1);
+  memset(padded->buf, ' ', padded->len);
+  padded->buf[MiB] = 'x';
+  char name[64];
+
+  enum libstring_isa top = libstring_isa();
+  for (int isa = LIBSTRING_ISA_SCALAR; isa <= (int)top; isa++) {
+    libstring_set_isa(isa);
+    sprintf(name, "count_char, %s", names[isa]);
+    BENCH(name, text->len, string_count_char(text, '\n'));
+    sprintf(name, "find_char (absent), %s", names[isa]);
+    BENCH(name, text->len, string_find_char(text, '<'));
+    sprintf(name, "find_any_of (absent), %s", names[isa]);
+    BENCH(name, text->len, string_find_any_of(text, set));
+    sprintf(name, "trim 1 MB of blanks each side, %s", names[isa]);
+    BENCH(name, padded->len, trim_len(padded));
+    sprintf(name, "replace_char, %s", names[isa]);
+    BENCH(name, text->len, replace_char_len(text));
+  }
+  libstring_set_isa(top);
+
+  free(padded);
+  free(set);
+  free(text);
+}
+
+/***********************************************************************/
+
+static char upper(char c) { return (c >= 'a' && c <= 'z') ? c - 32 : c; }
+
+static bool not_blank(char c) { return c != ' ' && c != '\n'; }
+
+static size_t map_len(const string_t *str) {
+  string_t *s = string_map(upper, str);
+  size_t len = s->len;
+  free(s);
+  return len;
+}
+
+static size_t map_table_len(const string_t *str, const char *table) {
+  string_t *s = string_map_table(str, table);
+  size_t len = s->len;
+  free(s);
+  return len;
+}
+
+static size_t filter_len(const string_t *str) {
+  string_t *s = string_filter(not_blank, str);
+  size_t len = s->len;
+  free(s);
+  return len;
+}
+
+static size_t filter_set_len(const string_t *str, const uint64_t *set) {
+  string_t *s = string_filter_set(str, set);
+  size_t len = s->len;
+  free(s);
+  return len;
+}
+
+/* Compares the callback and the table variants of map and filter. */
+void bench_classes() {
+  static const char *names[] = {"scalar", "sse2", "avx2", "avx512"};
+  string_t *text = random_text(16 * MiB);
+  char table[256];
+  uint64_t set[4] = {0};
+  for (int c = 0; c < 256; c++) {
+    table[c] = upper(c);
+    if (not_blank(c))
+      set[c / 64] |= (uint64_t)1 << (c % 64);
+  }
+  char name[64];
+
+  BENCH("upper case, string_map", text->len, map_len(text));
+  BENCH("strip blanks, string_filter", text->len, filter_len(text));
+  enum libstring_isa top = libstring_isa();
+  for (int isa = LIBSTRING_ISA_SCALAR; isa <= (int)top; isa++) {
+    libstring_set_isa(isa);
+    sprintf(name, "upper case, string_map_table, %s", names[isa]);
+    BENCH(name, text->len, map_table_len(text, table));
+    sprintf(name, "strip blanks, string_filter_set, %s", names[isa]);
+    BENCH(name, text->len, filter_set_len(text, set));
+  }
+  libstring_set_isa(top);
+
+  free(text);
+}
+
+/***********************************************************************/
+
+/* The strncmp()-based equality libstring used before. */
+static bool strncmp_equal(const string_t *s1, const string_t *s2) {
+  return s1->len == s2->len && strncmp(s1->buf, s2->buf, s1->len) == 0;
+}
+
+#define KEYS 2048
+
+static size_t find_strncmp(string_t **keys, string_t **probes) {
+  size_t n = 0;
+  for (size_t i = 0; i < KEYS; i++)
+    for (size_t j = 0; j < KEYS; j++)
+      if (strncmp_equal(keys[j], probes[i])) {
+        n += j;
+        break;
+      }
+  return n;
+}
+
+static size_t find_equal(const string_vector_t *svec, string_t **probes) {
+  size_t n = 0;
+  for (size_t i = 0; i < KEYS; i++)
+    n += string_vector_find(svec, probes[i]);
+  return n;
+}
+
+static size_t find_hashed(const string_hashed_t *keys,
+                          const string_hashed_t *probes) {
+  size_t n = 0;
+  for (size_t i = 0; i < KEYS; i++)
+    for (size_t j = 0; j < KEYS; j++)
+      if (string_hashed_equal(keys[j], probes[i])) {
+        n += j;
+        break;
+      }
+  return n;
+}
+
+/* Looks up paths with a long common prefix by linear search. */
+void bench_equal() {
+  string_vector_t *svec = string_vector_empty();
+  string_t *probes[KEYS];
+  string_hashed_t hkeys[KEYS], hprobes[KEYS];
+  char buf[64];
+  size_t bytes = 0;
+  for (size_t i = 0; i < KEYS; i++) {
+    snprintf(buf, sizeof(buf), "/usr/share/doc/pkg-%06zu/changelog.gz", i);
+    string_vector_add(svec, string_new(buf));
+    snprintf(buf, sizeof(buf), "/usr/share/doc/pkg-%06zu/changelog.gz",
+             (i % 2) ? i : i + KEYS);
+    probes[i] = string_new(buf);
+    bytes += probes[i]->len;
+  }
+  for (size_t i = 0; i < KEYS; i++) {
+    hkeys[i] = string_hashed(svec->buf[i]);
+    hprobes[i] = string_hashed(probes[i]);
+  }
+  bytes *= KEYS;
+
+  BENCH("find paths, strncmp equality", bytes, find_strncmp(svec->buf, probes));
+  BENCH("find paths, string_vector_find", bytes, find_equal(svec, probes));
+  BENCH("find paths, string_hashed_equal", bytes,
+        find_hashed(hkeys, hprobes));
+
+  for (size_t i = 0; i < KEYS; i++)
+    free(probes[i]);
+  string_vector_deepfree(svec);
+}
+
+/***********************************************************************/
+
+static void quality(const char *name, double value, const char *unit) {
+  printf("Quality %s: %*s%9.3f%s\n", name, (int)(IDENT - 2 - strlen(name)),
+         "", value, unit);
+}
+
+/* Hashes consecutive keys of `len` bytes, `count` of them. */
+static size_t hash_keys(const string_t *text, size_t len, size_t count) {
+  uint64_t h = 0;
+  for (size_t i = 0; i < count; i++) {
+    string_view_t v = {len, text->buf + (i * 61 & (MiB - 1))};
+    h ^= string_view_hash(v, i);
+  }
+  return (size_t)h;
+}
+
+static size_t hash_stream(const string_t *text, size_t part) {
+  string_hasher_t h;
+  string_hasher_init(&h, 0);
+  for (size_t i = 0; i < text->len; i += part)
+    string_hasher_update(&h, text->buf + i,
+                         (text->len - i < part) ? text->len - i : part);
+  return (size_t)string_hasher_final(&h);
+}
+
+/*
+ * Flips every input bit of random keys and reports the largest deviation
+ * of any output bit's flip probability from 1/2, in percent, next to the
+ * largest deviation expected by chance alone.
+ */
+static void avalanche(const char *name, size_t len, size_t trials) {
+  static unsigned flips[64 * 64 * 8][64];
+  char key[64];
+  memset(flips, 0, sizeof(flips));
+  for (size_t t = 0; t < trials; t++) {
+    for (size_t i = 0; i < len; i++)
+      key[i] = (char)rand();
+    uint64_t h = string_view_hash((string_view_t){len, key}, 0);
+    for (size_t bit = 0; bit < 8 * len; bit++) {
+      key[bit / 8] ^= 1 << bit % 8;
+      uint64_t d = h ^ string_view_hash((string_view_t){len, key}, 0);
+      key[bit / 8] ^= 1 << bit % 8;
+      for (int j = 0; j < 64; j++)
+        flips[bit][j] += d >> j & 1;
+    }
+  }
+  double worst = 0;
+  for (size_t bit = 0; bit < 8 * len; bit++)
+    for (int j = 0; j < 64; j++) {
+      double p = (double)flips[bit][j] / trials;
+      double bias = (p > 0.5) ? p - 0.5 : 0.5 - p;
+      worst = (bias > worst) ? bias : worst;
+    }
+  char unit[32];
+  double noise = sqrt(2 * log(2 * 64 * 8 * len)) / sqrt(trials);
+  snprintf(unit, sizeof(unit), " %% (chance %.3f %%)", 100 * noise);
+  quality(name, 200 * worst, unit);
+}
+
+static int compare_u64(const void *a, const void *b) {
+  uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+  return (x > y) - (x < y);
+}
+
+/* Counts the colliding pairs among the low 32 bits of the hashes. */
+static size_t collisions32(uint64_t *h, size_t n) {
+  size_t c = 0, run = 1;
+  for (size_t i = 0; i < n; i++)
+    h[i] &= 0xffffffff;
+  qsort(h, n, sizeof(uint64_t), compare_u64);
+  for (size_t i = 1; i <= n; i++)
+    if (i < n && h[i] == h[i - 1]) {
+      run += 1;
+    } else {
+      c += run * (run - 1) / 2;
+      run = 1;
+    }
+  return c;
+}
+
+/* The chi-square statistic of the hashes in 2^16 buckets. */
+static double chi_square(const uint64_t *h, size_t n, int shift) {
+  static size_t buckets[1 << 16];
+  memset(buckets, 0, sizeof(buckets));
+  for (size_t i = 0; i < n; i++)
+    buckets[h[i] >> shift & 0xffff] += 1;
+  double e = (double)n / (1 << 16), chi = 0;
+  for (size_t i = 0; i < 1 << 16; i++)
+    chi += (buckets[i] - e) * (buckets[i] - e) / e;
+  return chi;
+}
+
+/*
+ * Measures the throughput of string_hash() and runs quality tests in the
+ * spirit of SMHasher. An ideal hash has an avalanche bias near 0, about
+ * as many collisions as expected, and chi-square values near 65535.
+ */
+void bench_hash() {
+  static const size_t lens[] = {8, 32, 256, 4096};
+  string_t *text = random_text(16 * MiB);
+  char name[IDENT];
+
+  for (size_t i = 0; i < sizeof(lens) / sizeof(lens[0]); i++) {
+    size_t count = MiB / lens[i] + 1024;
+    snprintf(name, sizeof(name), "hash %zu-byte keys", lens[i]);
+    BENCH(name, lens[i] * count, hash_keys(text, lens[i], count));
+  }
+  BENCH("hash 16 MB", text->len, string_hash(text, 0));
+  BENCH("hash 16 MB in 4 KB parts, hasher", text->len,
+        hash_stream(text, 4096));
+  BENCH("hash 16 MB in 100 B parts, hasher", text->len,
+        hash_stream(text, 100));
+
+  srand(1);
+  avalanche("avalanche bias, 4-byte keys", 4, 100000);
+  avalanche("avalanche bias, 16-byte keys", 16, 100000);
+  avalanche("avalanche bias, 64-byte keys", 64, 20000);
+
+  size_t n = 1 << 20;
+  uint64_t *h = malloc(n * sizeof(uint64_t));
+  char key[32];
+  double expected = (double)n * (n - 1) / 2 / 4294967296.0;
+  for (size_t i = 0; i < n; i++) {
+    int len = snprintf(key, sizeof(key), "key%zu", i);
+    h[i] = string_view_hash((string_view_t){len, key}, 0);
+  }
+  quality("chi-square, low bits", chi_square(h, n, 0), "");
+  quality("chi-square, high bits", chi_square(h, n, 48), "");
+  quality("collisions, sequential keys", collisions32(h, n), "");
+  for (size_t i = 0; i < n; i++)
+    h[i] = string_view_hash((string_view_t){sizeof(i), (char *)&i}, 0);
+  quality("collisions, integer keys", collisions32(h, n), "");
+  size_t m = 0;
+  for (size_t i = 0; i < 256; i++)
+    for (size_t j = i + 1; j < 256; j++) {
+      memset(key, 0, sizeof(key));
+      key[i / 8] ^= 1 << i % 8;
+      key[j / 8] ^= 1 << j % 8;
+      h[m++] = string_view_hash((string_view_t){32, key}, 0);
+    }
+  quality("collisions, 2-bit sparse keys", collisions32(h, m), "");
+  quality("collisions expected, 2^20 keys", expected, "");
+  quality("collisions expected, sparse keys",
+          (double)m * (m - 1) / 2 / 4294967296.0, "");
+
+  free(h);
+  free(text);
+}
+
+/***********************************************************************/
+
+#define PROBES 4096
+
+static string_t *map_key(size_t i) {
+  char buf[32];
+  snprintf(buf, sizeof(buf), "user:%zu:session", i);
+  return string_new(buf);
+}
+
+static size_t map_find(const string_map_t *map, string_t **probes) {
+  size_t hits = 0;
+  for (size_t i = 0; i < PROBES; i++)
+    hits += string_map_find(map, probes[i]) != NULL;
+  return hits;
+}
+
+static size_t vector_find(const string_vector_t *svec, string_t **probes,
+                          size_t n) {
+  size_t hits = 0;
+  for (size_t i = 0; i < n; i++)
+    hits += string_vector_find(svec, probes[i]) >= 0;
+  return hits;
+}
+
+/*
+ * Looks up keys that are present and absent in equal parts in a
+ * string_map_t, by scanning a string_vector_t, and in the hash index of
+ * the vector. The scan visits half of the keys on average for a hit and
+ * all of them for a miss, so it gets fewer probes as the key count grows.
+ */
+static void bench_map_on(const char *what, size_t count) {
+  string_vector_t *svec = string_vector_empty();
+  string_t *probes[PROBES];
+  char name[64];
+  for (size_t i = 0; i < count; i++)
+    string_vector_add(svec, map_key(i));
+  for (size_t i = 0; i < PROBES; i++)
+    probes[i] = map_key((i % 2) ? i * 7919 % count : count + i);
+
+  double start = now();
+  string_map_t *map = string_map_new(0);
+  for (size_t i = 0; i < count; i++)
+    string_map_insert(map, svec->buf[i], svec->buf[i]);
+  snprintf(name, sizeof(name), "map %s keys, string_map_insert", what);
+  report_ops(name, count, now() - start);
+
+  snprintf(name, sizeof(name), "map %s keys, string_map_find", what);
+  BENCH_OPS(name, PROBES, map_find(map, probes));
+  size_t n = PROBES * 1000 / count;
+  n = (n < 2) ? 2 : (n > PROBES) ? PROBES : n;
+  snprintf(name, sizeof(name), "map %s keys, string_vector_find", what);
+  BENCH_OPS(name, n, vector_find(svec, probes, n));
+
+  start = now();
+  string_vector_index(svec);
+  snprintf(name, sizeof(name), "map %s keys, string_vector_index", what);
+  report_ops(name, count, now() - start);
+  snprintf(name, sizeof(name), "map %s keys, indexed vector_find", what);
+  BENCH_OPS(name, PROBES, vector_find(svec, probes, PROBES));
+  printf("Memory map %s keys, vector index: %*s%9zu bytes\n", what,
+         (int)(IDENT - 24 - strlen(what)), "", string_vector_index_bytes(svec));
+
+  string_map_free(map);
+  for (size_t i = 0; i < PROBES; i++)
+    free(probes[i]);
+  string_vector_deepfree(svec);
+}
+
+void bench_map() {
+  bench_map_on("1K", 1000);
+  bench_map_on("10K", 10000);
+  bench_map_on("100K", 100000);
+  bench_map_on("1M", 1000000);
+  bench_map_on("10M", 10000000);
+}
+
+/***********************************************************************/
+
+#define FIELDS 1000000
+#define DISTINCT 4096
+#define INTERN_THREADS 4
+
+typedef struct {
+  string_intern_t *intern;
+  const string_view_t *fields;
+} intern_job_t;
+
+static size_t copy_fields(const string_view_t *fields) {
+  size_t n = 0;
+  for (size_t i = 0; i < FIELDS; i++) {
+    string_t *s = string_view_tostring(fields[i]);
+    n += s->len;
+    free(s);
+  }
+  return n;
+}
+
+static size_t intern_fields(string_intern_t *intern,
+                            const string_view_t *fields) {
+  size_t n = 0;
+  for (size_t i = 0; i < FIELDS; i++)
+    n += (size_t)string_intern_view(intern, fields[i]);
+  return n;
+}
+
+static void *intern_worker(void *arg) {
+  intern_job_t *job = arg;
+  return (void *)intern_fields(job->intern, job->fields);
+}
+
+static size_t intern_parallel(string_intern_t *intern,
+                              const string_view_t *fields) {
+  pthread_t threads[INTERN_THREADS];
+  intern_job_t job = {intern, fields};
+  size_t n = 0;
+  void *ret;
+  for (int i = 0; i < INTERN_THREADS; i++)
+    pthread_create(&threads[i], NULL, intern_worker, &job);
+  for (int i = 0; i < INTERN_THREADS; i++) {
+    pthread_join(threads[i], &ret);
+    n += (size_t)ret;
+  }
+  return n;
+}
+
+static size_t live_bytes() {
+  libstring_alloc_stats_t stats;
+  libstring_alloc_stats(&stats);
+  return stats.live_bytes;
+}
+
+/*
+ * Fields that repeat a few thousand distinct values, as copied by
+ * string_split() and as interned. The first interning run inserts the
+ * values, all later ones only look them up. The memory both hold is
+ * measured with the counting allocator, so it includes the tables and
+ * arena chunks of the interning table.
+ */
+void bench_intern() {
+  char(*values)[24] = malloc(DISTINCT * sizeof(*values));
+  string_view_t *fields = malloc(FIELDS * sizeof(string_view_t));
+  string_t **copies = malloc(FIELDS * sizeof(string_t *));
+  for (size_t i = 0; i < DISTINCT; i++)
+    snprintf(values[i], sizeof(values[i]), "attr_%zu", i * 7919);
+  srand(42);
+  for (size_t i = 0; i < FIELDS; i++) {
+    const char *v = values[rand() % DISTINCT];
+    fields[i] = (string_view_t){strlen(v), v};
+  }
+
+  string_intern_t *intern = string_intern_new();
+  BENCH_OPS("intern fields, string_t copies", FIELDS, copy_fields(fields));
+  BENCH_OPS("intern fields, string_intern_view", FIELDS,
+            intern_fields(intern, fields));
+  BENCH_OPS("intern fields, 4 threads", INTERN_THREADS * FIELDS,
+            intern_parallel(intern, fields));
+  string_intern_free(intern);
+
+  libstring_allocator_t counting = libstring_counting_allocator(NULL);
+  libstring_set_allocator(&counting);
+  size_t base = live_bytes();
+  for (size_t i = 0; i < FIELDS; i++)
+    copies[i] = string_view_tostring(fields[i]);
+  size_t copied = live_bytes() - base;
+  for (size_t i = 0; i < FIELDS; i++)
+    libstring_free(copies[i]);
+  base = live_bytes();
+  intern = string_intern_new();
+  intern_fields(intern, fields);
+  size_t interned = live_bytes() - base;
+  string_intern_free(intern);
+  libstring_set_allocator(NULL);
+  printf("Memory string_t copies: %*s%9zu bytes\n", IDENT - 16, "", copied);
+  printf("Memory interned strings: %*s%9zu bytes\n", IDENT - 17, "",
+         interned);
+
+  free(copies);
+  free(fields);
+  free(values);
+}
+
+/***********************************************************************/
+
+static size_t split_lines(const string_t *text) {
+  string_vector_t *lines = string_split(text, '\n');
+  size_t n = 0;
+  for (size_t i = 0; i < string_vector_len(lines); i++) {
+    string_t *t = string_trim(lines->buf[i]);
+    n += t->len;
+    free(t);
+  }
+  string_vector_deepfree(lines);
+  return n;
+}
+
+static size_t split_lines_view(const string_t *text) {
+  string_view_vector_t *lines = string_view_split(string_view(text), '\n');
+  size_t n = 0;
+  for (size_t i = 0; i < string_view_vector_len(lines); i++)
+    n += string_view_trim(lines->buf[i]).len;
+  string_view_vector_free(lines);
+  return n;
+}
+
+void bench_view() {
+  string_t *text = random_text(16 * MiB);
+
+  BENCH("split and trim lines", text->len, split_lines(text));
+  BENCH("split and trim lines, views", text->len, split_lines_view(text));
+
+  free(text);
+}
+
+/***********************************************************************/
+
+/* The byte-by-byte delimiter loop string_split used before. */
+static size_t fields_loop(const string_t *text, char delimiter) {
+  size_t n = 0, start = 0;
+  for (size_t i = 0; i < text->len; i++)
+    if (text->buf[i] == delimiter) {
+      n += i - start;
+      start = i + 1;
+    }
+  return n + text->len - start;
+}
+
+static size_t fields_iter(const string_t *text, char delimiter) {
+  string_split_iter_t it = string_split_iter(string_view(text), delimiter);
+  string_view_t field;
+  size_t n = 0;
+  while (string_split_next(&it, &field))
+    n += field.len;
+  return n;
+}
+
+/* Reads the first byte of every field, as a consumer would. */
+static size_t fields_split(const string_t *text, char delimiter) {
+  string_vector_t *svec = string_split(text, delimiter);
+  size_t n = 0;
+  for (size_t i = 0; i < string_vector_len(svec); i++)
+    if (svec->buf[i]->len)
+      n += (unsigned char)svec->buf[i]->buf[0];
+  string_vector_deepfree(svec);
+  return n;
+}
+
+static size_t fields_flat(const string_t *text, char delimiter) {
+  string_flatvec_t *fvec = string_split_flat(text, delimiter);
+  size_t n = 0;
+  for (size_t i = 0; i < string_flatvec_len(fvec); i++) {
+    string_view_t v = string_flatvec_get(fvec, i);
+    if (v.len)
+      n += (unsigned char)v.buf[0];
+  }
+  string_flatvec_free(fvec);
+  return n;
+}
+
+void bench_split() {
+  string_t *text = random_text(16 * MiB);
+
+  BENCH("split on blanks, byte loop", text->len, fields_loop(text, ' '));
+  BENCH("split on blanks, split iterator", text->len, fields_iter(text, ' '));
+  BENCH("split on newlines, byte loop", text->len, fields_loop(text, '\n'));
+  BENCH("split on newlines, split iterator", text->len,
+        fields_iter(text, '\n'));
+  BENCH("split on blanks, string_split", text->len, fields_split(text, ' '));
+  BENCH("split on blanks, string_split_flat", text->len,
+        fields_flat(text, ' '));
+  BENCH("split on newlines, string_split", text->len,
+        fields_split(text, '\n'));
+  BENCH("split on newlines, string_split_flat", text->len,
+        fields_flat(text, '\n'));
+
+  free(text);
+}
+
+/***********************************************************************/
+
+/* Compares the delimiter at every position, as string_ssplit used to. */
+static size_t sfields_loop(const string_t *text, const string_t *del) {
+  size_t n = 0, start = 0;
+  for (size_t i = 0; i + del->len <= text->len;)
+    if (memcmp(text->buf + i, del->buf, del->len) == 0) {
+      n += i - start;
+      i += del->len;
+      start = i;
+    } else {
+      i += 1;
+    }
+  return n + text->len - start;
+}
+
+static size_t sfields_iter(const string_t *text, const string_needle_t *del) {
+  string_ssplit_iter_t it =
+      string_ssplit_iter(string_view(text), del, STRING_SPLIT_ALL);
+  string_view_t field;
+  size_t n = 0;
+  while (string_ssplit_next(&it, &field))
+    n += field.len;
+  return n;
+}
+
+static size_t sfields_split(const string_t *text, const string_t *del) {
+  string_vector_t *svec = string_ssplit(text, del);
+  size_t n = string_vector_len(svec);
+  string_vector_deepfree(svec);
+  return n;
+}
+
+static void bench_ssplit_on(const char *what, const string_t *text,
+                            const string_t *del) {
+  char name[IDENT];
+  string_needle_t *needle = string_needle_new(del);
+
+  snprintf(name, sizeof(name), "ssplit on %s, byte loop", what);
+  BENCH(name, text->len, sfields_loop(text, del));
+  snprintf(name, sizeof(name), "ssplit on %s, iterator", what);
+  BENCH(name, text->len, sfields_iter(text, needle));
+  snprintf(name, sizeof(name), "ssplit on %s, string_ssplit", what);
+  BENCH(name, text->len, sfields_split(text, del));
+
+  free(needle);
+}
+
+void bench_ssplit() {
+  string_t *text = random_text(16 * MiB);
+  string_t *lf = string_new("\n");
+  string_t *crlf = string_new("\r\n");
+  string_t *blank = string_new(" ");
+  string_t *cell = string_new("</td><td>");
+  string_t *lines = string_replace(text, lf, crlf);
+  string_t *cells = string_replace(text, blank, cell);
+
+  bench_ssplit_on("\\r\\n", lines, crlf);
+  bench_ssplit_on("</td><td>", cells, cell);
+
+  free(text);
+  free(lf);
+  free(crlf);
+  free(blank);
+  free(cell);
+  free(lines);
+  free(cells);
+}
+
+/***********************************************************************/
+
+enum { BY_REMOVE, BY_SWAP_REMOVE, BY_REMOVE_IF, BY_ADD, BY_EXTEND };
+
+static bool every_other(string_t *str) {
+  static bool drop;
+  (void)str;
+  drop = !drop;
+  return drop;
+}
+
+/*
+ * Fills an arena vector with n strings and removes half of them, or only
+ * fills it, in the given way. The vector lives in an arena so that removed
+ * strings are not freed and the strings can be reused by the next run.
+ */
+static size_t vector_ops(string_arena_t *arena, string_t **strs, size_t n,
+                         int how) {
+  string_arena_reset(arena);
+  string_vector_t *svec = string_arena_vector_empty(arena);
+  if (how == BY_ADD)
+    for (size_t i = 0; i < n; i++)
+      string_vector_add(svec, strs[i]);
+  else
+    string_vector_extend(svec, strs, n);
+  if (how == BY_REMOVE)
+    for (size_t i = 0; i < n / 2; i++)
+      string_vector_remove(svec, i);
+  else if (how == BY_SWAP_REMOVE)
+    for (size_t i = 0; i < n / 2; i++)
+      string_vector_swap_remove(svec, i);
+  else if (how == BY_REMOVE_IF)
+    string_vector_remove_if(svec, every_other);
+  return string_vector_len(svec);
+}
+
+static void bench_vector_on(const char *what, size_t n) {
+  string_arena_t *arena = string_arena_create(0);
+  string_t **strs = malloc(n * sizeof(string_t *));
+  char name[64];
+  for (size_t i = 0; i < n; i++)
+    strs[i] = string_arena_nnew(arena, "x", 1);
+  string_arena_t *ops = string_arena_create(0);
+
+  snprintf(name, sizeof(name), "vector %s, string_vector_remove", what);
+  BENCH_OPS(name, n / 2, vector_ops(ops, strs, n, BY_REMOVE));
+  snprintf(name, sizeof(name), "vector %s, string_vector_swap_remove", what);
+  BENCH_OPS(name, n / 2, vector_ops(ops, strs, n, BY_SWAP_REMOVE));
+  snprintf(name, sizeof(name), "vector %s, string_vector_remove_if", what);
+  BENCH_OPS(name, n / 2, vector_ops(ops, strs, n, BY_REMOVE_IF));
+  snprintf(name, sizeof(name), "vector %s, string_vector_add", what);
+  BENCH_OPS(name, n, vector_ops(ops, strs, n, BY_ADD));
+  snprintf(name, sizeof(name), "vector %s, string_vector_extend", what);
+  BENCH_OPS(name, n, vector_ops(ops, strs, n, BY_EXTEND));
+
+  string_arena_free(ops);
+  string_arena_free(arena);
+  free(strs);
+}
+
+/*
+ * Removing half of the strings one by one with string_vector_remove() is
+ * quadratic, so its rate falls with the size while the others stay flat.
+ * The removal rates include filling the vector.
+ */
+void bench_vector() {
+  bench_vector_on("1K", 1000);
+  bench_vector_on("10K", 10000);
+  bench_vector_on("100K", 100000);
+}
+
+/***********************************************************************/
+
+#define LOG_KEYS 10000000
+
+static int compare_strings(const void *a, const void *b) {
+  return string_compare(*(string_t *const *)a, *(string_t *const *)b);
+}
+
+/* Timestamped log keys, which share long prefixes. */
+static string_t *log_key() {
+  char buf[96];
+  int r = rand();
+  snprintf(buf, sizeof(buf),
+           "2024-06-%02dT%02d:%02d:%02d.%03dZ host-%03d GET /api/items/%d",
+           1 + r % 28, rand() % 24, rand() % 60, rand() % 60, rand() % 1000,
+           rand() % 200, rand() % 100000);
+  return string_new(buf);
+}
+
+static size_t sort_keys(const string_vector_t *keys, string_vector_t *work,
+                        int how) {
+  memcpy(work->buf, keys->buf, string_vector_len(keys) * sizeof(string_t *));
+  if (how == 0)
+    qsort(work->buf, string_vector_len(work), sizeof(string_t *),
+          compare_strings);
+  else if (how == 1)
+    string_vector_sort(work);
+  else if (how == 2)
+    string_vector_sort_stable(work);
+  else
+    string_vector_sort_parallel(work, 0);
+  return (size_t)work->buf[0];
+}
+
+void bench_sort() {
+  string_vector_t *keys = string_vector_empty();
+  string_vector_t *work = string_vector_empty();
+  srand(42);
+  for (size_t i = 0; i < LOG_KEYS; i++)
+    string_vector_add(keys, log_key());
+  string_vector_extend(work, keys->buf, LOG_KEYS);
+
+  BENCH_OPS("sort 10M log keys, qsort", LOG_KEYS, sort_keys(keys, work, 0));
+  BENCH_OPS("sort 10M log keys, string_vector_sort", LOG_KEYS,
+            sort_keys(keys, work, 1));
+  BENCH_OPS("sort 10M log keys, sort_stable", LOG_KEYS,
+            sort_keys(keys, work, 2));
+  BENCH_OPS("sort 10M log keys, sort_parallel", LOG_KEYS,
+            sort_keys(keys, work, 3));
+
+  string_vector_free(work);
+  string_vector_deepfree(keys);
+}
+
+/***********************************************************************/
+
+enum { SET_NESTED, SET_UNION, SET_INTERSECT, SET_DIFFERENCE };
+
+static size_t set_op(const string_vector_t *a, const string_vector_t *b,
+                     int op) {
+  size_t n = 0;
+  if (op == SET_NESTED) {
+    for (size_t i = 0; i < string_vector_len(a); i++)
+      n += string_vector_find(b, a->buf[i]) < 0;
+    return n;
+  }
+  string_vector_t *res;
+  if (op == SET_UNION)
+    res = string_vector_union(a, b);
+  else if (op == SET_INTERSECT)
+    res = string_vector_intersect(a, b);
+  else
+    res = string_vector_difference(a, b);
+  n = string_vector_len(res);
+  string_vector_deepfree(res);
+  return n;
+}
+
+/*
+ * Combines two vectors of `count` keys that overlap by half, first in
+ * shuffled order, which hashes them, then sorted, which merges them. The
+ * nested loop of string_vector_find() computes the difference the naive
+ * way and only runs for small counts.
+ */
+static void bench_set_on(const char *what, size_t count) {
+  string_vector_t *a = string_vector_empty();
+  string_vector_t *b = string_vector_empty();
+  char name[64];
+  for (size_t i = 0; i < count; i++) {
+    string_vector_add(a, map_key(i * 7919 % count));
+    string_vector_add(b, map_key(count / 2 + i * 7919 % count));
+  }
+
+  if (count <= 10000) {
+    snprintf(name, sizeof(name), "set %s keys, nested find", what);
+    BENCH_OPS(name, 2 * count, set_op(a, b, SET_NESTED));
+  }
+  snprintf(name, sizeof(name), "set %s keys, union", what);
+  BENCH_OPS(name, 2 * count, set_op(a, b, SET_UNION));
+  snprintf(name, sizeof(name), "set %s keys, intersect", what);
+  BENCH_OPS(name, 2 * count, set_op(a, b, SET_INTERSECT));
+  snprintf(name, sizeof(name), "set %s keys, difference", what);
+  BENCH_OPS(name, 2 * count, set_op(a, b, SET_DIFFERENCE));
+
+  string_vector_sort(a);
+  string_vector_sort(b);
+  snprintf(name, sizeof(name), "set %s keys, sorted union", what);
+  BENCH_OPS(name, 2 * count, set_op(a, b, SET_UNION));
+  snprintf(name, sizeof(name), "set %s keys, sorted difference", what);
+  BENCH_OPS(name, 2 * count, set_op(a, b, SET_DIFFERENCE));
+
+  string_vector_deepfree(a);
+  string_vector_deepfree(b);
+}
+
+void bench_set() {
+  bench_set_on("1K", 1000);
+  bench_set_on("10K", 10000);
+  bench_set_on("100K", 100000);
+  bench_set_on("1M", 1000000);
+}
+
+/***********************************************************************/
+
+#define PARALLEL_KEYS 1000000
+
+static string_t *upper_key(string_t *s) { return string_map(upper, s); }
+
+static bool odd_hash(string_t *s) { return string_hash(s, 0) & 1; }
+
+static string_t *max_key(string_t *value, string_t *element) {
+  string_t *s = (string_compare(value, element) >= 0) ? value : element;
+  return string_nnew(s->buf, s->len);
+}
+
+static size_t run_parallel(const string_vector_t *keys, int what,
+                           size_t threads) {
+  size_t n;
+  if (what == 2) {
+    string_t *s = string_vector_reduce_parallel(max_key, keys, NULL, threads);
+    n = s->len;
+    free(s);
+    return n;
+  }
+  string_vector_t *res =
+      (what == 0) ? string_vector_map_parallel(upper_key, keys, threads)
+                  : string_vector_filter_parallel(odd_hash, keys, threads);
+  n = string_vector_len(res);
+  string_vector_deepfree(res);
+  return n;
+}
+
+/*
+ * Runs the parallel map, filter, and reduce over 1M log keys with 1, 2,
+ * 4, ... threads, up to the number of online processors.
+ */
+void bench_parallel() {
+  static const char *what[] = {"map", "filter", "reduce"};
+  string_vector_t *keys = string_vector_empty();
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  char name[64];
+  srand(42);
+  for (size_t i = 0; i < PARALLEL_KEYS; i++)
+    string_vector_add(keys, log_key());
+
+  for (int w = 0; w < 3; w++)
+    for (long t = 1;; t *= 2) {
+      t = (t < cpus) ? t : (cpus > 0) ? cpus : 1;
+      snprintf(name, sizeof(name), "parallel %s 1M keys, %ld threads",
+               what[w], t);
+      BENCH_OPS(name, PARALLEL_KEYS, run_parallel(keys, w, t));
+      if (t >= cpus)
+        break;
+    }
+
+  string_vector_deepfree(keys);
+}
+
+/***********************************************************************/
+
+static size_t parse_records(string_t **records, string_arena_t *arena) {
+  size_t n = 0;
+  for (size_t i = 0; i < RECORDS; i++) {
+    string_vector_t *fields = string_arena_split(arena, records[i], ' ');
+    for (size_t k = 0; k < string_vector_len(fields); k++) {
+      string_t *t = string_arena_trim(arena, fields->buf[k]);
+      n += t->len;
+      if (!arena)
+        free(t);
+    }
+    if (arena)
+      string_arena_reset(arena);
+    else
+      string_vector_deepfree(fields);
+  }
+  return n;
+}
+
+void bench_arena() {
+  string_t *text = random_text(RECORDS * RECORD_LEN);
+  string_t **records = malloc(RECORDS * sizeof(string_t *));
+  for (size_t i = 0; i < RECORDS; i++) {
+    records[i] = string_alloc(RECORD_LEN);
+    memcpy(records[i]->buf, text->buf + i * RECORD_LEN, RECORD_LEN);
+  }
+  string_arena_t *arena = string_arena_create(0);
+
+  BENCH("split and trim records, malloc", text->len,
+        parse_records(records, NULL));
+  BENCH("split and trim records, arena", text->len,
+        parse_records(records, arena));
+
+  for (size_t i = 0; i < RECORDS; i++)
+    free(records[i]);
+  free(records);
+  string_arena_free(arena);
+  free(text);
+}
+
+/***********************************************************************/
+
+#define APPENDS 1000000
+#define CONCAT_APPENDS 20000
+
+static size_t build_concat(const string_t *word, size_t n) {
+  string_t *s = string_new("");
+  for (size_t i = 0; i < n; i++) {
+    string_t *t = string_concat(s, word);
+    free(s);
+    s = t;
+  }
+  size_t len = s->len;
+  free(s);
+  return len;
+}
+
+static size_t build_builder(const string_t *word, size_t n) {
+  string_builder_t *sb = string_builder_new(0);
+  for (size_t i = 0; i < n; i++)
+    string_builder_append(sb, word);
+  string_t *s = string_builder_finish(sb);
+  size_t len = s->len;
+  free(s);
+  return len;
+}
+
+static size_t build_int(size_t n) {
+  string_builder_t *sb = string_builder_new(0);
+  for (size_t i = 0; i < n; i++) {
+    string_builder_append_int(sb, i);
+    string_builder_append_char(sb, ',');
+  }
+  string_t *s = string_builder_finish(sb);
+  size_t len = s->len;
+  free(s);
+  return len;
+}
+
+void bench_builder() {
+  string_t *word = string_new("append, ");
+
+  /* string_concat() is quadratic, so it only gets 20K appends. */
+  BENCH("20K appends, string_concat", CONCAT_APPENDS * word->len,
+        build_concat(word, CONCAT_APPENDS));
+  BENCH("20K appends, builder", CONCAT_APPENDS * word->len,
+        build_builder(word, CONCAT_APPENDS));
+  BENCH("1M appends, builder", APPENDS * word->len,
+        build_builder(word, APPENDS));
+  BENCH("1M integers, builder", build_int(APPENDS), build_int(APPENDS));
+
+  free(word);
+}
+
+/***********************************************************************/
+
+static size_t count_readfd(const char *path, const string_needle_t *needle) {
+  int fd = open(path, O_RDONLY);
+  string_t *s = string_readfd(fd);
+  close(fd);
+  size_t n = string_needle_count(needle, s);
+  free(s);
+  return n;
+}
+
+static size_t count_mmap(const char *path, const string_needle_t *needle) {
+  const string_t *s = string_mmap_file(path, STRING_MMAP_SEQUENTIAL);
+  size_t n = string_needle_count(needle, s);
+  string_munmap(s);
+  return n;
+}
+
+/* Writes `text` to a new temporary file whose name is stored in `path`. */
+static void temp_file(char *path, const string_t *text) {
+  strcpy(path, "/tmp/bench-libstring-XXXXXX");
+  int fd = mkstemp(path);
+  if (fd < 0 || write(fd, text->buf, text->len) != (ssize_t)text->len) {
+    perror("temp_file");
+    exit(EXIT_FAILURE);
+  }
+  close(fd);
+}
+
+void bench_mmap() {
+  char path[32];
+  string_t *text = random_text(64 * MiB);
+  temp_file(path, text);
+  string_t *str = string_new("user_id=");
+  string_needle_t *needle = string_needle_new(str);
+
+  BENCH("count in 64 MB file, string_readfd", text->len,
+        count_readfd(path, needle));
+  BENCH("count in 64 MB file, string_mmap_file", text->len,
+        count_mmap(path, needle));
+
+  unlink(path);
+  free(needle);
+  free(str);
+  free(text);
+}
+
+/***********************************************************************/
+
+static size_t lines_readline(const char *path) {
+  FILE *f = fopen(path, "r");
+  size_t n = 0;
+  while (!feof(f)) {
+    string_t *s = string_readline(f);
+    n += s->len;
+    free(s);
+  }
+  fclose(f);
+  return n;
+}
+
+static size_t lines_reader(const char *path) {
+  int fd = open(path, O_RDONLY);
+  string_line_reader_t *r = string_line_reader_new(fd, 0);
+  string_view_t line;
+  size_t n = 0;
+  while (string_line_reader_next(r, &line, NULL))
+    n += line.len;
+  string_line_reader_free(r);
+  close(fd);
+  return n;
+}
+
+void bench_lines() {
+  char path[32];
+  string_t *text = random_text(64 * MiB);
+  temp_file(path, text);
+
+  BENCH("lines of 64 MB file, string_readline", text->len,
+        lines_readline(path));
+  BENCH("lines of 64 MB file, line reader", text->len, lines_reader(path));
+
+  unlink(path);
+  free(text);
+}
+
+/***********************************************************************/
+/***********************************************************************/
+
+int main() {
+  bench_search();
+  bench_needle();
+  bench_matcher();
+  bench_replace();
+  bench_chars();
+  bench_classes();
+  bench_equal();
+  bench_hash();
+  bench_map();
+  bench_intern();
+  bench_view();
+  bench_split();
+  bench_ssplit();
+  bench_vector();
+  bench_sort();
+  bench_set();
+  bench_parallel();
+  bench_arena();
+  bench_builder();
+  bench_mmap();
+  bench_lines();
+}
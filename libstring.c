@@ -1,10 +1,21 @@
 #include <assert.h>
-#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdarg.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#define likely(x) __builtin_expect(!!(x), 1)
 #define unlikely(x) __builtin_expect(!!(x), 0)
 
 #include "libstring.h"
@@ -12,459 +23,5031 @@
 #define BUF_LEN 65536
 #define CAP_DEFAULT 10
 
-string_t *string_colored(const char *str, enum stringcolor c) {
-  int n = strlen(str) + strlen(COLOR_DEFAULT) + strlen(COLOR_BLACK);
-  string_t *s = malloc(sizeof(string_t) + n);
-  if (unlikely(s == NULL))
-    return NULL;
-  s->len = n;
-  switch (c) {
-  case BLACK:
-    memcpy(s->buf, COLOR_BLACK, strlen(COLOR_BLACK));
-    break;
-  case RED:
-    memcpy(s->buf, COLOR_RED, strlen(COLOR_RED));
-    break;
-  case GREEN:
-    memcpy(s->buf, COLOR_GREEN, strlen(COLOR_GREEN));
-    break;
-  case YELLOW:
-    memcpy(s->buf, COLOR_YELLOW, strlen(COLOR_YELLOW));
-    break;
-  case BLUE:
-    memcpy(s->buf, COLOR_BLUE, strlen(COLOR_BLUE));
-    break;
-  case MAGENTA:
-    memcpy(s->buf, COLOR_MAGENTA, strlen(COLOR_MAGENTA));
-    break;
-  case CYAN:
-    memcpy(s->buf, COLOR_CYAN, strlen(COLOR_MAGENTA));
-    break;
-  case WHITE:
-    memcpy(s->buf, COLOR_WHITE, strlen(COLOR_WHITE));
-    break;
-  default:
-    break;
-  }
-  memcpy(&(s->buf[strlen(COLOR_BLACK)]), str, strlen(str));
-  n -= strlen(COLOR_DEFAULT);
-  memcpy(&(s->buf[n]), COLOR_DEFAULT, strlen(COLOR_DEFAULT));
-  return s;
+/*************************************************************************
+ *                             Allocator                                 *
+ *************************************************************************/
+
+static void *sys_malloc(void *ctx, size_t size) {
+  (void)ctx;
+  return malloc(size);
 }
 
-/**********************************************************************/
+static void *sys_realloc(void *ctx, void *ptr, size_t size) {
+  (void)ctx;
+  return realloc(ptr, size);
+}
 
-string_t *string_nnew(const char *str, size_t len) {
-  string_t *s = malloc(sizeof(string_t) + len);
-  if (unlikely(s == NULL))
-    return NULL;
-  s->len = len;
-  memcpy(s->buf, str, len);
-  return s;
+static void sys_free(void *ctx, void *ptr) {
+  (void)ctx;
+  free(ptr);
 }
 
-/**********************************************************************/
+static const libstring_allocator_t sys_allocator = {sys_malloc, sys_realloc,
+                                                    sys_free, NULL};
+static libstring_allocator_t allocator = {sys_malloc, sys_realloc, sys_free,
+                                          NULL};
 
-string_t *string_new(const char *str) { return string_nnew(str, strlen(str)); }
+void libstring_set_allocator(const libstring_allocator_t *a) {
+  allocator = a ? *a : sys_allocator;
+}
 
-/**********************************************************************/
+/*
+ * The counting allocator prefixes every block with a header that records
+ * its size, so that the live byte count can be maintained on free. The
+ * header is as large as the alignment malloc() guarantees.
+ */
 
-string_t *string_clone(const string_t *str) {
-  return string_nnew(str->buf, str->len);
+#define COUNT_HEADER 16
+#define COUNT_SITES 256
+
+static libstring_alloc_stats_t count_stats;
+static libstring_alloc_count_t count_sites[COUNT_SITES];
+static libstring_alloc_count_t count_other = {"(other)", 0, 0};
+
+static void count_live(size_t add, size_t sub) {
+  size_t live = __atomic_add_fetch(&count_stats.live_bytes, add - sub,
+                                   __ATOMIC_RELAXED);
+  size_t peak = __atomic_load_n(&count_stats.peak_bytes, __ATOMIC_RELAXED);
+  while (live > peak &&
+         !__atomic_compare_exchange_n(&count_stats.peak_bytes, &peak, live,
+                                      true, __ATOMIC_RELAXED,
+                                      __ATOMIC_RELAXED))
+    ;
 }
 
-/**********************************************************************/
+static void *count_malloc(void *ctx, size_t size) {
+  const libstring_allocator_t *b = ctx;
+  if (unlikely(size > SIZE_MAX - COUNT_HEADER))
+    return NULL;
+  char *p = b->malloc_fn(b->ctx, size + COUNT_HEADER);
+  if (unlikely(p == NULL))
+    return NULL;
+  *(size_t *)p = size;
+  __atomic_add_fetch(&count_stats.allocs, 1, __ATOMIC_RELAXED);
+  count_live(size, 0);
+  return p + COUNT_HEADER;
+}
 
-string_t *string_readfd(int fd) {
-  char buf[BUF_LEN];
-  int n = read(fd, buf, BUF_LEN - 1);
-  if (unlikely(n < 0))
-    return string_new("");
-  buf[n] = '\0';
-  return string_new(buf);
+static void *count_realloc(void *ctx, void *ptr, size_t size) {
+  const libstring_allocator_t *b = ctx;
+  if (ptr == NULL)
+    return count_malloc(ctx, size);
+  if (unlikely(size > SIZE_MAX - COUNT_HEADER))
+    return NULL;
+  char *p = (char *)ptr - COUNT_HEADER;
+  size_t old = *(size_t *)p;
+  p = b->realloc_fn(b->ctx, p, size + COUNT_HEADER);
+  if (unlikely(p == NULL))
+    return NULL;
+  *(size_t *)p = size;
+  __atomic_add_fetch(&count_stats.allocs, 1, __ATOMIC_RELAXED);
+  count_live(size, old);
+  return p + COUNT_HEADER;
 }
 
-/**********************************************************************/
+static void count_free(void *ctx, void *ptr) {
+  const libstring_allocator_t *b = ctx;
+  if (ptr == NULL)
+    return;
+  char *p = (char *)ptr - COUNT_HEADER;
+  __atomic_add_fetch(&count_stats.frees, 1, __ATOMIC_RELAXED);
+  count_live(0, *(size_t *)p);
+  b->free_fn(b->ctx, p);
+}
 
-string_t *string_readline(FILE *stream) {
-  char buf[BUF_LEN];
-  if (!fgets(buf, BUF_LEN - 1, stream))
-    return string_new("");
-  buf[strlen(buf) - 1] = '\0';
-  return string_new(buf);
+libstring_allocator_t
+libstring_counting_allocator(const libstring_allocator_t *backing) {
+  return (libstring_allocator_t){count_malloc, count_realloc, count_free,
+                                 (void *)(backing ? backing : &sys_allocator)};
 }
 
-/**********************************************************************/
+bool libstring_alloc_stats(libstring_alloc_stats_t *stats) {
+  stats->live_bytes =
+      __atomic_load_n(&count_stats.live_bytes, __ATOMIC_RELAXED);
+  stats->peak_bytes =
+      __atomic_load_n(&count_stats.peak_bytes, __ATOMIC_RELAXED);
+  stats->allocs = __atomic_load_n(&count_stats.allocs, __ATOMIC_RELAXED);
+  stats->frees = __atomic_load_n(&count_stats.frees, __ATOMIC_RELAXED);
+  return allocator.malloc_fn == count_malloc;
+}
 
-string_t *string_concat(const string_t *s1, const string_t *s2) {
-  string_t *s = malloc(sizeof(string_t) + s1->len + s2->len);
-  if (unlikely(s == NULL))
-    return NULL;
-  s->len = s1->len + s2->len;
-  memcpy(s->buf, s1->buf, s1->len);
-  memcpy(s->buf + s1->len, s2->buf, s2->len);
-  return s;
+/*
+ * Counts an allocation made by the function `fn`. The sites are keyed by
+ * the address of the function name, which is unique for __func__, in an
+ * open addressing table whose slots are claimed with compare-and-swap.
+ * The table has room for every function that allocates; should it fill
+ * up, further functions are counted under "(other)".
+ */
+static void count_site(const char *fn, size_t size) {
+  size_t h = ((uintptr_t)fn >> 3) % COUNT_SITES;
+  for (size_t i = 0; i < COUNT_SITES; i++) {
+    libstring_alloc_count_t *c = &count_sites[(h + i) % COUNT_SITES];
+    const char *cur = __atomic_load_n(&c->function, __ATOMIC_ACQUIRE);
+    if (cur == NULL)
+      (void)__atomic_compare_exchange_n(&c->function, &cur, fn, false,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+    if (cur == NULL || cur == fn) {
+      __atomic_add_fetch(&c->allocs, 1, __ATOMIC_RELAXED);
+      __atomic_add_fetch(&c->bytes, size, __ATOMIC_RELAXED);
+      return;
+    }
+  }
+  __atomic_add_fetch(&count_other.allocs, 1, __ATOMIC_RELAXED);
+  __atomic_add_fetch(&count_other.bytes, size, __ATOMIC_RELAXED);
 }
 
-/**********************************************************************/
+size_t libstring_alloc_counts(libstring_alloc_count_t *counts, size_t n) {
+  size_t k = 0;
+  for (size_t i = 0; i < COUNT_SITES; i++) {
+    const char *fn = __atomic_load_n(&count_sites[i].function,
+                                     __ATOMIC_ACQUIRE);
+    if (fn == NULL)
+      continue;
+    if (k < n) {
+      counts[k].function = fn;
+      counts[k].allocs =
+          __atomic_load_n(&count_sites[i].allocs, __ATOMIC_RELAXED);
+      counts[k].bytes =
+          __atomic_load_n(&count_sites[i].bytes, __ATOMIC_RELAXED);
+    }
+    k += 1;
+  }
+  size_t allocs = __atomic_load_n(&count_other.allocs, __ATOMIC_RELAXED);
+  if (allocs != 0) {
+    if (k < n) {
+      counts[k] = count_other;
+      counts[k].allocs = allocs;
+      counts[k].bytes = __atomic_load_n(&count_other.bytes, __ATOMIC_RELAXED);
+    }
+    k += 1;
+  }
+  return k;
+}
 
-string_t *string_trim(const string_t *str) {
-  size_t l = 0;
-  int r = str->len - 1;
-  while (l < str->len && isspace(str->buf[l]))
-    l += 1;
-  while (r >= 0 && isspace(str->buf[r]))
-    r -= 1;
-  r += 1;
+/*
+ * Every heap allocation of libstring goes through heap_alloc(),
+ * heap_realloc() and heap_free(). `fn` names the public function the
+ * allocation is counted for.
+ */
+static inline void *heap_alloc(size_t size, const char *fn) {
+  void *p = allocator.malloc_fn(allocator.ctx, size);
+  if (unlikely(allocator.malloc_fn == count_malloc) && likely(p != NULL))
+    count_site(fn, size);
+  return p;
+}
 
-  if (unlikely(l > (size_t)r))
-    return string_new("");
+static inline void *heap_realloc(void *ptr, size_t size, const char *fn) {
+  void *p = allocator.realloc_fn(allocator.ctx, ptr, size);
+  if (unlikely(allocator.malloc_fn == count_malloc) && likely(p != NULL))
+    count_site(fn, size);
+  return p;
+}
 
-  return string_nnew(&(str->buf[l]), r - l);
+static inline void heap_free(void *ptr) {
+  allocator.free_fn(allocator.ctx, ptr);
 }
 
-/**********************************************************************/
+void libstring_free(void *ptr) { heap_free(ptr); }
 
-string_t *string_map(charfunc_t fun, const string_t *str) {
-  string_t *s = string_clone(str);
-  if (unlikely(s == NULL))
-    return NULL;
-  for (size_t i = 0; i < s->len; i++) {
-    s->buf[i] = fun(s->buf[i]);
+/*************************************************************************
+ *                            Instruction Sets                           *
+ *************************************************************************/
+
+/*
+ * The SIMD code paths are chosen at run time from the instruction sets the
+ * CPU supports. libstring_set_isa() can lower the level, for example to
+ * compare the code paths in a benchmark. Kernels run in several threads at
+ * once, so the level is detected by whichever thread comes first and read
+ * with atomic loads. The flags are stored before the level is published.
+ */
+
+static int isa_detected = -1, isa_level = -1;
+static bool isa_vbmi; /* AVX-512 VBMI and VBMI2 byte permutes */
+
+static int isa_detect(void) {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_cpu_init();
+  if (!__builtin_cpu_supports("popcnt"))
+    goto sse2;
+  __atomic_store_n(&isa_vbmi,
+                   __builtin_cpu_supports("avx512vbmi") &&
+                       __builtin_cpu_supports("avx512vbmi2"),
+                   __ATOMIC_RELAXED);
+  if (__builtin_cpu_supports("avx512bw"))
+    return LIBSTRING_ISA_AVX512;
+  if (__builtin_cpu_supports("avx2"))
+    return LIBSTRING_ISA_AVX2;
+sse2:
+#endif
+#if defined(__SSE2__)
+  return LIBSTRING_ISA_SSE2;
+#else
+  return LIBSTRING_ISA_SCALAR;
+#endif
+}
+
+static inline int isa(void) {
+  int level = __atomic_load_n(&isa_level, __ATOMIC_ACQUIRE);
+  if (unlikely(level < 0)) {
+    int expected = -1;
+    level = isa_detect();
+    __atomic_store_n(&isa_detected, level, __ATOMIC_RELEASE);
+    if (!__atomic_compare_exchange_n(&isa_level, &expected, level, false,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+      level = expected;
   }
-  return s;
+  return level;
 }
 
-/**********************************************************************/
+enum libstring_isa libstring_isa(void) { return isa(); }
 
-string_t *string_filter(boolfunc_t fun, const string_t *str) {
-  int c = 0;
-  char *tmp = malloc(str->len);
-  memcpy(tmp, str->buf, str->len);
-  for (size_t i = 0; i < str->len; i++)
-    if (fun(str->buf[i]))
-      tmp[c++] = str->buf[i];
-  tmp[c] = '\0';
-  string_t *s = string_new(tmp);
-  free(tmp);
-  return s;
+enum libstring_isa libstring_set_isa(enum libstring_isa max) {
+  isa();
+  int detected = __atomic_load_n(&isa_detected, __ATOMIC_ACQUIRE);
+  int level = ((int)max < detected) ? (int)max : detected;
+  __atomic_store_n(&isa_level, level, __ATOMIC_RELEASE);
+  return level;
 }
 
-/**********************************************************************/
+/*************************************************************************
+ *                           Character Kernels                           *
+ *************************************************************************/
 
-int string_compare(const string_t *s1, const string_t *s2) {
-  int n = (s1->len < s2->len) ? s1->len : s2->len;
-  int r = strncmp(s1->buf, s2->buf, n);
+/*
+ * Each kernel exists in a scalar, an SSE2, an AVX2 and an AVX-512 version,
+ * collected in one table per instruction set level. The SSE2 and AVX2
+ * versions finish the last partial block with the scalar version; the
+ * AVX-512 versions use masked loads and stores instead.
+ *
+ * Whitespace is the ASCII set " \t\n\v\f\r", which is what isspace()
+ * matches in the C locale.
+ */
 
-  return r ? r : (int)(s1->len - s2->len);
+/* A set of bytes, as a bitmap for the scalar code, as a list of up to 16
+   bytes for SSE2, and as two nibble lookup tables for AVX2 and AVX-512. */
+typedef struct {
+  uint64_t bits[4];
+  unsigned char chars[16];
+  size_t nchars; /* number of distinct bytes, chars is valid if <= 16 */
+  uint8_t lo[16]; /* bit h set if byte h * 16 + i is in the set, h < 8 */
+  uint8_t hi[16]; /* bit h set if byte (h + 8) * 16 + i is in the set */
+} byteset_t;
+
+static void byteset_init_bits(byteset_t *s, const uint64_t bits[4]) {
+  memset(s, 0, sizeof(byteset_t));
+  memcpy(s->bits, bits, sizeof(s->bits));
+  for (int c = 0; c < 256; c++) {
+    if (!(bits[c >> 6] >> (c & 63) & 1))
+      continue;
+    if (s->nchars < 16)
+      s->chars[s->nchars] = c;
+    s->nchars += 1;
+    if (c < 128)
+      s->lo[c & 15] |= 1 << (c >> 4);
+    else
+      s->hi[c & 15] |= 1 << ((c >> 4) - 8);
+  }
 }
 
-/**********************************************************************/
+static void byteset_init(byteset_t *s, const char *buf, size_t n) {
+  uint64_t bits[4] = {0};
+  for (size_t i = 0; i < n; i++) {
+    unsigned char c = buf[i];
+    bits[c >> 6] |= (uint64_t)1 << (c & 63);
+  }
+  byteset_init_bits(s, bits);
+}
 
-bool string_equal(const string_t *s1, const string_t *s2) {
-  if (s1->len != s2->len)
-    return false;
-  return strncmp(s1->buf, s2->buf, s1->len) == 0 ? true : false;
+static inline bool byteset_has(const byteset_t *s, unsigned char c) {
+  return s->bits[c >> 6] >> (c & 63) & 1;
 }
 
-/**********************************************************************/
+static inline bool is_space(unsigned char c) {
+  return c == ' ' || (unsigned char)(c - '\t') < 5;
+}
 
-string_t *string_substring(const string_t *str, size_t start, size_t end) {
-  if (unlikely(!(start <= end) && (end <= str->len)))
-    return NULL;
+typedef struct {
+  size_t (*count)(const char *p, size_t n, char c);
+  size_t (*find)(const char *p, size_t n, char c);
+  size_t (*find_set)(const char *p, size_t n, const byteset_t *s);
+  size_t (*space_prefix)(const char *p, size_t n);
+  size_t (*space_suffix)(const char *p, size_t n);
+  void (*replace)(char *dst, const char *src, size_t n, char old, char new);
+  void (*translate)(char *dst, const char *src, size_t n, const char *table);
+  size_t (*select)(char *dst, const char *src, size_t n, const byteset_t *s);
+} char_kernels_t;
+
+/*
+ * count() returns the number of occurrences of c, find() and find_set()
+ * the offset of the first occurrence or n, space_prefix() the offset of
+ * the first byte that is not whitespace or n, and space_suffix() the
+ * offset after the last byte that is not whitespace or 0. translate()
+ * maps every byte through a table of 256 bytes, and select() copies the
+ * bytes in the set and returns their number.
+ */
 
-  return string_nnew(&(str->buf[start]), end - start);
+static size_t count_scalar(const char *p, size_t n, char c) {
+  size_t k = 0;
+  for (size_t i = 0; i < n; i++)
+    k += p[i] == c;
+  return k;
 }
 
-/**********************************************************************/
+static size_t find_scalar(const char *p, size_t n, char c) {
+  for (size_t i = 0; i < n; i++)
+    if (p[i] == c)
+      return i;
+  return n;
+}
 
-string_t *string_repeat(const string_t *str, size_t times) {
-  size_t n = str->len * times;
-  if (unlikely(!n))
-    return string_new("");
+static size_t find_set_scalar(const char *p, size_t n, const byteset_t *s) {
+  for (size_t i = 0; i < n; i++)
+    if (byteset_has(s, p[i]))
+      return i;
+  return n;
+}
 
-  string_t *s = malloc(sizeof(string_t) + n);
-  if (unlikely(!s))
-    return NULL;
+static size_t space_prefix_scalar(const char *p, size_t n) {
+  size_t i = 0;
+  while (i < n && is_space(p[i]))
+    i += 1;
+  return i;
+}
 
-  s->len = n;
-  for (size_t i = 0; i < times; i++)
-    memcpy(&(s->buf[i * (str->len)]), str->buf, str->len);
+static size_t space_suffix_scalar(const char *p, size_t n) {
+  while (n > 0 && is_space(p[n - 1]))
+    n -= 1;
+  return n;
+}
 
-  return s;
+static void replace_scalar(char *dst, const char *src, size_t n, char old,
+                           char new) {
+  for (size_t i = 0; i < n; i++)
+    dst[i] = (src[i] == old) ? new : src[i];
 }
 
-/**********************************************************************/
+static void translate_scalar(char *dst, const char *src, size_t n,
+                             const char *table) {
+  for (size_t i = 0; i < n; i++)
+    dst[i] = table[(unsigned char)src[i]];
+}
 
-char *string_tocstr(const string_t *str) {
-  char *cstr = malloc(str->len + 1);
-  if (unlikely(cstr == NULL))
-    return NULL;
-  memcpy(cstr, str->buf, str->len);
-  cstr[str->len] = '\0';
-  return cstr;
+static size_t select_scalar(char *dst, const char *src, size_t n,
+                            const byteset_t *s) {
+  size_t k = 0;
+  for (size_t i = 0; i < n; i++) {
+    dst[k] = src[i];
+    k += byteset_has(s, src[i]);
+  }
+  return k;
 }
 
-/**********************************************************************/
+static const char_kernels_t kernels_scalar = {
+    count_scalar,        find_scalar,         find_set_scalar,
+    space_prefix_scalar, space_suffix_scalar, replace_scalar,
+    translate_scalar,    select_scalar};
 
-static int string_substring_index_offset(const string_t *str,
-                                         const string_t *substring,
-                                         size_t offset) {
-  if (unlikely(substring->len == 0))
-    return offset;
-  if (unlikely(substring->len > (str->len - offset)))
-    return -1;
-
-  for (size_t i = offset; i <= str->len - substring->len; i++) {
-    for (size_t j = 0; j < substring->len; j++) {
-      if (str->buf[i + j] != substring->buf[j])
-        break;
-      if ((j + 1) == substring->len)
-        return i;
+#if defined(__SSE2__)
+
+static inline __m128i space_sse2(__m128i x) {
+  __m128i d = _mm_sub_epi8(x, _mm_set1_epi8('\t'));
+  return _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8(' ')),
+                      _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(4)), d));
+}
+
+/* Counts in byte lanes, which are summed up before they can overflow. */
+static size_t count_sse2(const char *p, size_t n, char c) {
+  const __m128i v = _mm_set1_epi8(c);
+  size_t i = 0, k = 0;
+  while (i + 16 <= n) {
+    __m128i acc = _mm_setzero_si128();
+    for (int j = 0; j < 255 && i + 16 <= n; j++, i += 16) {
+      __m128i x = _mm_loadu_si128((const __m128i *)(p + i));
+      acc = _mm_sub_epi8(acc, _mm_cmpeq_epi8(x, v));
     }
+    __m128i sum = _mm_sad_epu8(acc, _mm_setzero_si128());
+    k += _mm_cvtsi128_si32(sum) + _mm_extract_epi16(sum, 4);
   }
-  return -1;
+  return k + count_scalar(p + i, n - i, c);
 }
 
-int string_substring_index(const string_t *str, const string_t *substring) {
-  return string_substring_index_offset(str, substring, 0);
+static size_t find_sse2(const char *p, size_t n, char c) {
+  const __m128i v = _mm_set1_epi8(c);
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m128i x = _mm_loadu_si128((const __m128i *)(p + i));
+    int m = _mm_movemask_epi8(_mm_cmpeq_epi8(x, v));
+    if (m)
+      return i + __builtin_ctz(m);
+  }
+  return i + find_scalar(p + i, n - i, c);
 }
 
-/**********************************************************************/
+static size_t find_set_sse2(const char *p, size_t n, const byteset_t *s) {
+  if (s->nchars > 16)
+    return find_set_scalar(p, n, s);
+  __m128i v[16];
+  for (size_t j = 0; j < s->nchars; j++)
+    v[j] = _mm_set1_epi8(s->chars[j]);
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m128i x = _mm_loadu_si128((const __m128i *)(p + i));
+    __m128i eq = _mm_setzero_si128();
+    for (size_t j = 0; j < s->nchars; j++)
+      eq = _mm_or_si128(eq, _mm_cmpeq_epi8(x, v[j]));
+    int m = _mm_movemask_epi8(eq);
+    if (m)
+      return i + __builtin_ctz(m);
+  }
+  return i + find_set_scalar(p + i, n - i, s);
+}
 
-bool string_is_substring(const string_t *str, const string_t *sub, size_t off) {
-  if (unlikely(sub->len + off > str->len))
-    return false;
-  if (unlikely(sub->len == 0))
-    return true;
-  return strncmp(&(str->buf[off]), sub->buf, sub->len) ? false : true;
+static size_t space_prefix_sse2(const char *p, size_t n) {
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m128i x = _mm_loadu_si128((const __m128i *)(p + i));
+    int m = ~_mm_movemask_epi8(space_sse2(x)) & 0xffff;
+    if (m)
+      return i + __builtin_ctz(m);
+  }
+  return i + space_prefix_scalar(p + i, n - i);
 }
 
-/**********************************************************************/
+static size_t space_suffix_sse2(const char *p, size_t n) {
+  for (; n >= 16; n -= 16) {
+    __m128i x = _mm_loadu_si128((const __m128i *)(p + n - 16));
+    int m = ~_mm_movemask_epi8(space_sse2(x)) & 0xffff;
+    if (m)
+      return n - __builtin_clz(m) + 16;
+  }
+  return space_suffix_scalar(p, n);
+}
 
-string_t *string_replace_char(const string_t *str, char old, char new) {
-  string_t *s = string_clone(str);
+static void replace_sse2(char *dst, const char *src, size_t n, char old,
+                         char new) {
+  const __m128i vo = _mm_set1_epi8(old), vn = _mm_set1_epi8(new);
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m128i x = _mm_loadu_si128((const __m128i *)(src + i));
+    __m128i eq = _mm_cmpeq_epi8(x, vo);
+    _mm_storeu_si128((__m128i *)(dst + i),
+                     _mm_or_si128(_mm_and_si128(eq, vn),
+                                  _mm_andnot_si128(eq, x)));
+  }
+  replace_scalar(dst + i, src + i, n - i, old, new);
+}
 
-  for (size_t i = 0; i < s->len; i++)
-    s->buf[i] = (s->buf[i] == old) ? new : s->buf[i];
+/* SSE2 has no byte shuffle, so translate() and select() stay scalar. */
+static const char_kernels_t kernels_sse2 = {
+    count_sse2,        find_sse2,         find_set_sse2,
+    space_prefix_sse2, space_suffix_sse2, replace_sse2,
+    translate_scalar,  select_scalar};
 
-  return s;
-}
+#endif
 
-/**********************************************************************/
+#if defined(__x86_64__) || defined(__i386__)
 
-/*
- * Implementation of the string_replace() function is based on the
- * suggestion by OpenAI's GPT-3.5
- */
+__attribute__((target("avx2"))) static inline __m256i space_avx2(__m256i x) {
+  __m256i d = _mm256_sub_epi8(x, _mm256_set1_epi8('\t'));
+  return _mm256_or_si256(
+      _mm256_cmpeq_epi8(x, _mm256_set1_epi8(' ')),
+      _mm256_cmpeq_epi8(_mm256_min_epu8(d, _mm256_set1_epi8(4)), d));
+}
 
-string_t *string_replace(const string_t *str, const string_t *old,
-                         const string_t *new) {
-  size_t n = 0;
-  int offset = 0;
+__attribute__((target("avx2"))) static size_t
+count_avx2(const char *p, size_t n, char c) {
+  const __m256i v = _mm256_set1_epi8(c);
+  size_t i = 0, k = 0;
+  for (; i + 32 <= n; i += 32) {
+    __m256i x = _mm256_loadu_si256((const __m256i *)(p + i));
+    k += __builtin_popcount(
+        (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, v)));
+  }
+  return k + count_scalar(p + i, n - i, c);
+}
 
-  while ((offset = string_substring_index_offset(str, old, offset)) > -1) {
-    offset += old->len;
-    n += 1;
+__attribute__((target("avx2"))) static size_t
+find_avx2(const char *p, size_t n, char c) {
+  const __m256i v = _mm256_set1_epi8(c);
+  size_t i = 0;
+  for (; i + 32 <= n; i += 32) {
+    __m256i x = _mm256_loadu_si256((const __m256i *)(p + i));
+    uint32_t m = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, v));
+    if (m)
+      return i + __builtin_ctz(m);
   }
+  return i + find_scalar(p + i, n - i, c);
+}
 
-  if (n == 0)
-    return string_clone(str);
-  size_t len = str->len + n * (new->len - old->len);
-  string_t *s = malloc(sizeof(string_t) + len);
-  s->len = len;
+/*
+ * Set membership with nibble lookups: the low nibble of each byte selects
+ * a row of the byte set, the high nibble selects a bit in that row. lo and
+ * hi are the rows of the byte set, broadcast to both lanes.
+ */
+__attribute__((target("avx2"))) static inline uint32_t
+member_avx2(__m256i x, __m256i lo, __m256i hi) {
+  const __m256i bit = _mm256_setr_epi8(
+      1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8,
+      16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+  const __m256i nibble = _mm256_set1_epi8(0x0f);
+  __m256i xl = _mm256_and_si256(x, nibble);
+  __m256i xh = _mm256_and_si256(_mm256_srli_epi16(x, 4), nibble);
+  __m256i row = _mm256_blendv_epi8(_mm256_shuffle_epi8(lo, xl),
+                                   _mm256_shuffle_epi8(hi, xl),
+                                   _mm256_cmpgt_epi8(xh, _mm256_set1_epi8(7)));
+  __m256i hit = _mm256_and_si256(row, _mm256_shuffle_epi8(bit, xh));
+  return ~(uint32_t)_mm256_movemask_epi8(
+      _mm256_cmpeq_epi8(hit, _mm256_setzero_si256()));
+}
 
-  char *t = s->buf;
-  int curr = 0;
-  offset = 0;
-  while (n--) {
-    offset = string_substring_index_offset(str, old, offset);
-    memcpy(t, str->buf + curr, offset - curr);
-    t += offset - curr;
+__attribute__((target("avx2"))) static size_t
+find_set_avx2(const char *p, size_t n, const byteset_t *s) {
+  const __m256i lo = _mm256_broadcastsi128_si256(
+      _mm_loadu_si128((const __m128i *)s->lo));
+  const __m256i hi = _mm256_broadcastsi128_si256(
+      _mm_loadu_si128((const __m128i *)s->hi));
+  size_t i = 0;
+  for (; i + 32 <= n; i += 32) {
+    __m256i x = _mm256_loadu_si256((const __m256i *)(p + i));
+    uint32_t m = member_avx2(x, lo, hi);
+    if (m)
+      return i + __builtin_ctz(m);
+  }
+  return i + find_set_scalar(p + i, n - i, s);
+}
 
-    memcpy(t, new->buf, new->len);
-    t += new->len;
-    curr = offset + old->len;
-    offset += old->len;
+__attribute__((target("avx2"))) static size_t
+space_prefix_avx2(const char *p, size_t n) {
+  size_t i = 0;
+  for (; i + 32 <= n; i += 32) {
+    __m256i x = _mm256_loadu_si256((const __m256i *)(p + i));
+    uint32_t m = ~(uint32_t)_mm256_movemask_epi8(space_avx2(x));
+    if (m)
+      return i + __builtin_ctz(m);
   }
-  memcpy(t, str->buf + curr, str->len - curr);
+  return i + space_prefix_scalar(p + i, n - i);
+}
 
-  return s;
+__attribute__((target("avx2"))) static size_t
+space_suffix_avx2(const char *p, size_t n) {
+  for (; n >= 32; n -= 32) {
+    __m256i x = _mm256_loadu_si256((const __m256i *)(p + n - 32));
+    uint32_t m = ~(uint32_t)_mm256_movemask_epi8(space_avx2(x));
+    if (m)
+      return n - __builtin_clz(m);
+  }
+  return space_suffix_scalar(p, n);
 }
 
-/**********************************************************************/
+__attribute__((target("avx2"))) static void
+replace_avx2(char *dst, const char *src, size_t n, char old, char new) {
+  const __m256i vo = _mm256_set1_epi8(old), vn = _mm256_set1_epi8(new);
+  size_t i = 0;
+  for (; i + 32 <= n; i += 32) {
+    __m256i x = _mm256_loadu_si256((const __m256i *)(src + i));
+    _mm256_storeu_si256((__m256i *)(dst + i),
+                        _mm256_blendv_epi8(x, vn, _mm256_cmpeq_epi8(x, vo)));
+  }
+  replace_scalar(dst + i, src + i, n - i, old, new);
+}
 
-string_vector_t *string_split(const string_t *str, char delimiter) {
-  string_vector_t *svec = string_vector_empty();
-  size_t start = 0;
-  for (size_t i = 0; i < string_len(str); i++)
-    if (str->buf[i] == delimiter) {
-      string_vector_add(svec, string_nnew(&(str->buf[start]), i - start));
-      start = i + 1;
+/*
+ * A 256-byte table lookup with 16-byte shuffles. Row k of the table is
+ * stored XORed with row k - 1 of its half, and the lookup XORs the rows
+ * 0..h of the half a byte falls into, which leaves row h. The index of row
+ * k is the byte minus 16 * k with signed saturation: the shuffle yields 0
+ * for the rows above h, where the index is negative, and for the other
+ * half, where the index starts out negative.
+ */
+__attribute__((target("avx2"))) static void
+translate_avx2(char *dst, const char *src, size_t n, const char *table) {
+  size_t i = 0;
+  if (n >= 32) {
+    __m256i rows[16];
+    for (int k = 0; k < 16; k++) {
+      __m128i r = _mm_loadu_si128((const __m128i *)(table + 16 * k));
+      if (k % 8)
+        r = _mm_xor_si128(
+            r, _mm_loadu_si128((const __m128i *)(table + 16 * (k - 1))));
+      rows[k] = _mm256_broadcastsi128_si256(r);
     }
-  string_vector_add(svec,
-                    string_nnew(&(str->buf[start]), string_len(str) - start));
-  return svec;
+    const __m256i step = _mm256_set1_epi8(16);
+    for (; i + 32 <= n; i += 32) {
+      __m256i lo = _mm256_loadu_si256((const __m256i *)(src + i));
+      __m256i hi = _mm256_xor_si256(lo, _mm256_set1_epi8(-128));
+      __m256i y = _mm256_setzero_si256();
+      for (int k = 0; k < 8; k++) {
+        y = _mm256_xor_si256(y, _mm256_shuffle_epi8(rows[k], lo));
+        y = _mm256_xor_si256(y, _mm256_shuffle_epi8(rows[k + 8], hi));
+        lo = _mm256_subs_epi8(lo, step);
+        hi = _mm256_subs_epi8(hi, step);
+      }
+      _mm256_storeu_si256((__m256i *)(dst + i), y);
+    }
+  }
+  translate_scalar(dst + i, src + i, n - i, table);
 }
 
-/**********************************************************************/
+/*
+ * Byte k of compact_shuffle[m] is the position of the k-th set bit of m, so
+ * that a byte shuffle with it gathers the bytes of an 8-byte group that a
+ * mask m selects.
+ */
+static const uint64_t compact_shuffle[256] = {
+    0x0000000000000000, 0x0000000000000000, 0x0000000000000001,
+    0x0000000000000100, 0x0000000000000002, 0x0000000000000200,
+    0x0000000000000201, 0x0000000000020100, 0x0000000000000003,
+    0x0000000000000300, 0x0000000000000301, 0x0000000000030100,
+    0x0000000000000302, 0x0000000000030200, 0x0000000000030201,
+    0x0000000003020100, 0x0000000000000004, 0x0000000000000400,
+    0x0000000000000401, 0x0000000000040100, 0x0000000000000402,
+    0x0000000000040200, 0x0000000000040201, 0x0000000004020100,
+    0x0000000000000403, 0x0000000000040300, 0x0000000000040301,
+    0x0000000004030100, 0x0000000000040302, 0x0000000004030200,
+    0x0000000004030201, 0x0000000403020100, 0x0000000000000005,
+    0x0000000000000500, 0x0000000000000501, 0x0000000000050100,
+    0x0000000000000502, 0x0000000000050200, 0x0000000000050201,
+    0x0000000005020100, 0x0000000000000503, 0x0000000000050300,
+    0x0000000000050301, 0x0000000005030100, 0x0000000000050302,
+    0x0000000005030200, 0x0000000005030201, 0x0000000503020100,
+    0x0000000000000504, 0x0000000000050400, 0x0000000000050401,
+    0x0000000005040100, 0x0000000000050402, 0x0000000005040200,
+    0x0000000005040201, 0x0000000504020100, 0x0000000000050403,
+    0x0000000005040300, 0x0000000005040301, 0x0000000504030100,
+    0x0000000005040302, 0x0000000504030200, 0x0000000504030201,
+    0x0000050403020100, 0x0000000000000006, 0x0000000000000600,
+    0x0000000000000601, 0x0000000000060100, 0x0000000000000602,
+    0x0000000000060200, 0x0000000000060201, 0x0000000006020100,
+    0x0000000000000603, 0x0000000000060300, 0x0000000000060301,
+    0x0000000006030100, 0x0000000000060302, 0x0000000006030200,
+    0x0000000006030201, 0x0000000603020100, 0x0000000000000604,
+    0x0000000000060400, 0x0000000000060401, 0x0000000006040100,
+    0x0000000000060402, 0x0000000006040200, 0x0000000006040201,
+    0x0000000604020100, 0x0000000000060403, 0x0000000006040300,
+    0x0000000006040301, 0x0000000604030100, 0x0000000006040302,
+    0x0000000604030200, 0x0000000604030201, 0x0000060403020100,
+    0x0000000000000605, 0x0000000000060500, 0x0000000000060501,
+    0x0000000006050100, 0x0000000000060502, 0x0000000006050200,
+    0x0000000006050201, 0x0000000605020100, 0x0000000000060503,
+    0x0000000006050300, 0x0000000006050301, 0x0000000605030100,
+    0x0000000006050302, 0x0000000605030200, 0x0000000605030201,
+    0x0000060503020100, 0x0000000000060504, 0x0000000006050400,
+    0x0000000006050401, 0x0000000605040100, 0x0000000006050402,
+    0x0000000605040200, 0x0000000605040201, 0x0000060504020100,
+    0x0000000006050403, 0x0000000605040300, 0x0000000605040301,
+    0x0000060504030100, 0x0000000605040302, 0x0000060504030200,
+    0x0000060504030201, 0x0006050403020100, 0x0000000000000007,
+    0x0000000000000700, 0x0000000000000701, 0x0000000000070100,
+    0x0000000000000702, 0x0000000000070200, 0x0000000000070201,
+    0x0000000007020100, 0x0000000000000703, 0x0000000000070300,
+    0x0000000000070301, 0x0000000007030100, 0x0000000000070302,
+    0x0000000007030200, 0x0000000007030201, 0x0000000703020100,
+    0x0000000000000704, 0x0000000000070400, 0x0000000000070401,
+    0x0000000007040100, 0x0000000000070402, 0x0000000007040200,
+    0x0000000007040201, 0x0000000704020100, 0x0000000000070403,
+    0x0000000007040300, 0x0000000007040301, 0x0000000704030100,
+    0x0000000007040302, 0x0000000704030200, 0x0000000704030201,
+    0x0000070403020100, 0x0000000000000705, 0x0000000000070500,
+    0x0000000000070501, 0x0000000007050100, 0x0000000000070502,
+    0x0000000007050200, 0x0000000007050201, 0x0000000705020100,
+    0x0000000000070503, 0x0000000007050300, 0x0000000007050301,
+    0x0000000705030100, 0x0000000007050302, 0x0000000705030200,
+    0x0000000705030201, 0x0000070503020100, 0x0000000000070504,
+    0x0000000007050400, 0x0000000007050401, 0x0000000705040100,
+    0x0000000007050402, 0x0000000705040200, 0x0000000705040201,
+    0x0000070504020100, 0x0000000007050403, 0x0000000705040300,
+    0x0000000705040301, 0x0000070504030100, 0x0000000705040302,
+    0x0000070504030200, 0x0000070504030201, 0x0007050403020100,
+    0x0000000000000706, 0x0000000000070600, 0x0000000000070601,
+    0x0000000007060100, 0x0000000000070602, 0x0000000007060200,
+    0x0000000007060201, 0x0000000706020100, 0x0000000000070603,
+    0x0000000007060300, 0x0000000007060301, 0x0000000706030100,
+    0x0000000007060302, 0x0000000706030200, 0x0000000706030201,
+    0x0000070603020100, 0x0000000000070604, 0x0000000007060400,
+    0x0000000007060401, 0x0000000706040100, 0x0000000007060402,
+    0x0000000706040200, 0x0000000706040201, 0x0000070604020100,
+    0x0000000007060403, 0x0000000706040300, 0x0000000706040301,
+    0x0000070604030100, 0x0000000706040302, 0x0000070604030200,
+    0x0000070604030201, 0x0007060403020100, 0x0000000000070605,
+    0x0000000007060500, 0x0000000007060501, 0x0000000706050100,
+    0x0000000007060502, 0x0000000706050200, 0x0000000706050201,
+    0x0000070605020100, 0x0000000007060503, 0x0000000706050300,
+    0x0000000706050301, 0x0000070605030100, 0x0000000706050302,
+    0x0000070605030200, 0x0000070605030201, 0x0007060503020100,
+    0x0000000007060504, 0x0000000706050400, 0x0000000706050401,
+    0x0000070605040100, 0x0000000706050402, 0x0000070605040200,
+    0x0000070605040201, 0x0007060504020100, 0x0000000706050403,
+    0x0000070605040300, 0x0000070605040301, 0x0007060504030100,
+    0x0000070605040302, 0x0007060504030200, 0x0007060504030201,
+    0x0706050403020100
+};
 
-string_vector_t *string_ssplit(const string_t *str, string_t *delimiter) {
-  string_vector_t *svec = string_vector_empty();
-  int idx = string_substring_index(str, delimiter);
-  if (idx == -1) {
-    string_vector_add(svec, string_clone(str));
-    return svec;
+/*
+ * Compacts the selected bytes of each 8-byte group with a byte shuffle from
+ * compact_shuffle[]. PEXT would do the same without a table, but it needs
+ * BMI2 and is microcoded on AMD processors before Zen 3. The stores may run
+ * ahead of the result, but never beyond the end of the block just read.
+ */
+__attribute__((target("avx2,popcnt"))) static size_t
+select_avx2(char *dst, const char *src, size_t n, const byteset_t *s) {
+  const __m256i lo = _mm256_broadcastsi128_si256(
+      _mm_loadu_si128((const __m128i *)s->lo));
+  const __m256i hi = _mm256_broadcastsi128_si256(
+      _mm_loadu_si128((const __m128i *)s->hi));
+  size_t i = 0, k = 0;
+  for (; i + 32 <= n; i += 32) {
+    __m256i x = _mm256_loadu_si256((const __m256i *)(src + i));
+    uint32_t m = member_avx2(x, lo, hi);
+    if (m == UINT32_MAX) {
+      _mm256_storeu_si256((__m256i *)(dst + k), x);
+      k += 32;
+      continue;
+    }
+    for (int j = 0; m != 0; j += 8, m >>= 8) {
+      __m128i w = _mm_loadl_epi64((const __m128i *)(src + i + j));
+      __m128i idx =
+          _mm_loadl_epi64((const __m128i *)&compact_shuffle[m & 0xff]);
+      _mm_storel_epi64((__m128i *)(dst + k), _mm_shuffle_epi8(w, idx));
+      k += __builtin_popcount(m & 0xff);
+    }
   }
-  string_vector_add(svec, string_nnew(str->buf, idx));
-  idx += string_len(delimiter);
+  return k + select_scalar(dst + k, src + i, n - i, s);
+}
 
-  for (size_t i = idx; i <= string_len(str) - string_len(delimiter); i++) {
-    for (size_t j = 0; str->buf[i + j] == delimiter->buf[j]; j++)
-      if ((j + 1) == delimiter->len - 1) {
-        string_vector_add(svec, string_nnew(&(str->buf[idx]), i - idx));
-        idx = i + string_len(delimiter);
-        i += string_len(delimiter);
-        break;
-      }
-  }
-  if ((size_t)idx <= string_len(str))
-    string_vector_add(svec,
-                      string_nnew(&(str->buf[idx]), string_len(str) - idx));
+static const char_kernels_t kernels_avx2 = {
+    count_avx2,        find_avx2,         find_set_avx2,
+    space_prefix_avx2, space_suffix_avx2, replace_avx2,
+    translate_avx2,    select_avx2};
 
-  return svec;
+/* The mask of the first min(n, 64) bytes of a block. */
+static inline uint64_t block_mask(size_t n) {
+  return (n >= 64) ? ~(uint64_t)0 : ((uint64_t)1 << n) - 1;
 }
 
-/*************************************************************************
- *                           String Vector                               *
- *************************************************************************/
+__attribute__((target("avx512f,avx512bw"))) static inline __mmask64
+space_avx512(__m512i x) {
+  __m512i d = _mm512_sub_epi8(x, _mm512_set1_epi8('\t'));
+  return _mm512_cmpeq_epi8_mask(x, _mm512_set1_epi8(' ')) |
+         _mm512_cmple_epu8_mask(d, _mm512_set1_epi8(4));
+}
 
-string_vector_t *string_vector_empty() {
-  string_vector_t *svec = malloc(sizeof(string_vector_t));
-  if (unlikely(svec == NULL))
-    return NULL;
-  svec->buf = malloc(CAP_DEFAULT * sizeof(string_t *));
-  svec->cap = CAP_DEFAULT;
-  svec->top = -1;
-  return svec;
+__attribute__((target("avx512f,avx512bw"))) static size_t
+count_avx512(const char *p, size_t n, char c) {
+  const __m512i v = _mm512_set1_epi8(c);
+  size_t k = 0;
+  for (size_t i = 0; i < n; i += 64) {
+    __mmask64 b = block_mask(n - i);
+    __m512i x = _mm512_maskz_loadu_epi8(b, p + i);
+    k += __builtin_popcountll(_mm512_mask_cmpeq_epi8_mask(b, x, v));
+  }
+  return k;
 }
 
-string_vector_t *string_vector_new(string_t *str) {
-  string_vector_t *svec = string_vector_empty();
-  if (unlikely(svec == NULL))
-    return NULL;
-  string_vector_add(svec, str);
-  return svec;
+__attribute__((target("avx512f,avx512bw"))) static size_t
+find_avx512(const char *p, size_t n, char c) {
+  const __m512i v = _mm512_set1_epi8(c);
+  for (size_t i = 0; i < n; i += 64) {
+    __mmask64 b = block_mask(n - i);
+    __m512i x = _mm512_maskz_loadu_epi8(b, p + i);
+    uint64_t m = _mm512_mask_cmpeq_epi8_mask(b, x, v);
+    if (m)
+      return i + __builtin_ctzll(m);
+  }
+  return n;
 }
 
-bool string_vector_is_empty(const string_vector_t *svec) {
-  return svec->top == -1;
+/* Set membership as in member_avx2(). */
+__attribute__((target("avx512f,avx512bw"))) static inline __mmask64
+member_avx512(__m512i x, __m512i lo, __m512i hi) {
+  const __m512i bit = _mm512_broadcast_i32x4(
+      _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64,
+                    -128));
+  const __m512i nibble = _mm512_set1_epi8(0x0f);
+  __m512i xl = _mm512_and_si512(x, nibble);
+  __m512i xh = _mm512_and_si512(_mm512_srli_epi16(x, 4), nibble);
+  __m512i row = _mm512_mask_blend_epi8(
+      _mm512_cmpgt_epu8_mask(xh, _mm512_set1_epi8(7)),
+      _mm512_shuffle_epi8(lo, xl), _mm512_shuffle_epi8(hi, xl));
+  return _mm512_test_epi8_mask(row, _mm512_shuffle_epi8(bit, xh));
 }
 
-void string_vector_free(string_vector_t *svec) {
-  free(svec->buf);
-  free(svec);
+__attribute__((target("avx512f,avx512bw"))) static size_t
+find_set_avx512(const char *p, size_t n, const byteset_t *s) {
+  const __m512i lo =
+      _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i *)s->lo));
+  const __m512i hi =
+      _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i *)s->hi));
+  for (size_t i = 0; i < n; i += 64) {
+    __mmask64 b = block_mask(n - i);
+    __m512i x = _mm512_maskz_loadu_epi8(b, p + i);
+    uint64_t m = member_avx512(x, lo, hi) & b;
+    if (m)
+      return i + __builtin_ctzll(m);
+  }
+  return n;
 }
 
-void string_vector_deepfree(string_vector_t *svec) {
-  for (int i = 0; i <= svec->top; i++)
-    free(svec->buf[i]);
-  string_vector_free(svec);
+__attribute__((target("avx512f,avx512bw"))) static size_t
+space_prefix_avx512(const char *p, size_t n) {
+  for (size_t i = 0; i < n; i += 64) {
+    __mmask64 b = block_mask(n - i);
+    uint64_t m = ~space_avx512(_mm512_maskz_loadu_epi8(b, p + i)) & b;
+    if (m)
+      return i + __builtin_ctzll(m);
+  }
+  return n;
+}
+
+__attribute__((target("avx512f,avx512bw"))) static size_t
+space_suffix_avx512(const char *p, size_t n) {
+  while (n > 0) {
+    size_t k = (n < 64) ? n : 64;
+    __mmask64 b = block_mask(k);
+    uint64_t m = ~space_avx512(_mm512_maskz_loadu_epi8(b, p + n - k)) & b;
+    if (m)
+      return n - k + 64 - __builtin_clzll(m);
+    n -= k;
+  }
+  return 0;
+}
+
+__attribute__((target("avx512f,avx512bw"))) static void
+replace_avx512(char *dst, const char *src, size_t n, char old, char new) {
+  const __m512i vo = _mm512_set1_epi8(old), vn = _mm512_set1_epi8(new);
+  for (size_t i = 0; i < n; i += 64) {
+    __mmask64 b = block_mask(n - i);
+    __m512i x = _mm512_maskz_loadu_epi8(b, src + i);
+    __m512i y = _mm512_mask_blend_epi8(_mm512_cmpeq_epi8_mask(x, vo), x, vn);
+    _mm512_mask_storeu_epi8(dst + i, b, y);
+  }
+}
+
+/* A 256-byte table lookup as two 128-byte permutes, one per half. */
+__attribute__((target("avx512f,avx512bw,avx512vbmi"))) static void
+translate_vbmi(char *dst, const char *src, size_t n, const char *table) {
+  const __m512i t0 = _mm512_loadu_si512((const void *)table);
+  const __m512i t1 = _mm512_loadu_si512((const void *)(table + 64));
+  const __m512i t2 = _mm512_loadu_si512((const void *)(table + 128));
+  const __m512i t3 = _mm512_loadu_si512((const void *)(table + 192));
+  for (size_t i = 0; i < n; i += 64) {
+    __mmask64 b = block_mask(n - i);
+    __m512i x = _mm512_maskz_loadu_epi8(b, src + i);
+    __m512i y = _mm512_mask_blend_epi8(_mm512_movepi8_mask(x),
+                                       _mm512_permutex2var_epi8(t0, x, t1),
+                                       _mm512_permutex2var_epi8(t2, x, t3));
+    _mm512_mask_storeu_epi8(dst + i, b, y);
+  }
+}
+
+__attribute__((target("avx512f,avx512bw,avx512vbmi2,popcnt"))) static size_t
+select_vbmi(char *dst, const char *src, size_t n, const byteset_t *s) {
+  const __m512i lo =
+      _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i *)s->lo));
+  const __m512i hi =
+      _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i *)s->hi));
+  size_t k = 0;
+  for (size_t i = 0; i < n; i += 64) {
+    __mmask64 b = block_mask(n - i);
+    __m512i x = _mm512_maskz_loadu_epi8(b, src + i);
+    __mmask64 m = member_avx512(x, lo, hi) & b;
+    size_t c = __builtin_popcountll(m);
+    _mm512_mask_storeu_epi8(dst + k, block_mask(c),
+                            _mm512_maskz_compress_epi8(m, x));
+    k += c;
+  }
+  return k;
+}
+
+/* Without VBMI, translate() and select() use the AVX2 versions. */
+static const char_kernels_t kernels_avx512 = {
+    count_avx512,        find_avx512,         find_set_avx512,
+    space_prefix_avx512, space_suffix_avx512, replace_avx512,
+    translate_avx2,      select_avx2};
+
+static const char_kernels_t kernels_avx512_vbmi = {
+    count_avx512,        find_avx512,         find_set_avx512,
+    space_prefix_avx512, space_suffix_avx512, replace_avx512,
+    translate_vbmi,      select_vbmi};
+
+#endif
+
+static const char_kernels_t *kernels(void) {
+  switch (isa()) {
+#if defined(__x86_64__) || defined(__i386__)
+  case LIBSTRING_ISA_AVX512:
+    return __atomic_load_n(&isa_vbmi, __ATOMIC_RELAXED) ? &kernels_avx512_vbmi
+                                                        : &kernels_avx512;
+  case LIBSTRING_ISA_AVX2:
+    return &kernels_avx2;
+#endif
+#if defined(__SSE2__)
+  case LIBSTRING_ISA_SSE2:
+    return &kernels_sse2;
+#endif
+  default:
+    return &kernels_scalar;
+  }
+}
+
+/*************************************************************************
+ *                              Comparing                                *
+ *************************************************************************/
+
+static inline uint64_t load64(const char *p) {
+  uint64_t v;
+  memcpy(&v, p, 8);
+  return v;
+}
+
+static inline uint32_t load32(const char *p) {
+  uint32_t v;
+  memcpy(&v, p, 4);
+  return v;
+}
+
+/*
+ * Compares the first and the last word first, which settles most unequal
+ * strings, then the words in between. Only long strings call memcmp().
+ */
+static inline bool bytes_equal(const char *a, const char *b, size_t n) {
+  if (n >= 8) {
+    if (load64(a) != load64(b) || load64(a + n - 8) != load64(b + n - 8))
+      return false;
+    if (n > 64)
+      return memcmp(a + 8, b + 8, n - 16) == 0;
+    for (size_t i = 8; i + 8 < n; i += 8)
+      if (load64(a + i) != load64(b + i))
+        return false;
+    return true;
+  }
+  if (n >= 4)
+    return load32(a) == load32(b) && load32(a + n - 4) == load32(b + n - 4);
+  for (size_t i = 0; i < n; i++)
+    if (a[i] != b[i])
+      return false;
+  return true;
+}
+
+/*
+ * Compares as unsigned bytes. The first word is compared in big-endian
+ * order, so that its first differing byte decides as it does in memcmp().
+ */
+static inline int bytes_compare(const char *a, size_t m, const char *b,
+                                size_t n) {
+  size_t k = (m < n) ? m : n;
+  if (k >= 8) {
+    uint64_t x = load64(a), y = load64(b);
+    if (x != y) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+      x = __builtin_bswap64(x);
+      y = __builtin_bswap64(y);
+#endif
+      return (x < y) ? -1 : 1;
+    }
+  }
+  int r = k ? memcmp(a, b, k) : 0;
+  if (r)
+    return r;
+  return (m < n) ? -1 : (m > n);
+}
+
+/*************************************************************************
+ *                               Hashing                                 *
+ *************************************************************************/
+
+/*
+ * A 64-bit hash in the style of wyhash: the input is read in 8-byte words,
+ * mixed into the state by 64x64->128-bit multiplications whose halves are
+ * XORed together.
+ */
+
+static const uint64_t hash_secret[4] = {
+    0xa0761d6478bd642full, 0xe7037ed1a0b428dbull, 0x8ebc6af09c88c6e3ull,
+    0x589965cc75374cc3ull};
+
+static inline void mul128(uint64_t *a, uint64_t *b) {
+#if defined(__SIZEOF_INT128__)
+  __uint128_t r = (__uint128_t)*a * *b;
+  *a = (uint64_t)r;
+  *b = (uint64_t)(r >> 64);
+#else
+  uint64_t ha = *a >> 32, hb = *b >> 32, la = (uint32_t)*a, lb = (uint32_t)*b;
+  uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+  uint64_t t = rl + (rm0 << 32), c = t < rl, lo = t + (rm1 << 32);
+  c += lo < t;
+  *a = lo;
+  *b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+static inline uint64_t mix(uint64_t a, uint64_t b) {
+  mul128(&a, &b);
+  return a ^ b;
+}
+
+static inline uint64_t hash_seed(uint64_t seed) {
+  return seed ^ mix(seed ^ hash_secret[0], hash_secret[1]);
+}
+
+/* Mixes a 48-byte block into three independent lanes. */
+static inline void hash_block(uint64_t st[3], const char *p) {
+  const uint64_t *s = hash_secret;
+  st[0] = mix(load64(p) ^ s[1], load64(p + 8) ^ st[0]);
+  st[1] = mix(load64(p + 16) ^ s[2], load64(p + 24) ^ st[1]);
+  st[2] = mix(load64(p + 32) ^ s[3], load64(p + 40) ^ st[2]);
+}
+
+/*
+ * Hashes the last i <= 48 bytes at p of an input of n bytes. If n > 16,
+ * the 16 bytes before p must be the input bytes preceding p.
+ */
+static inline uint64_t hash_tail(const char *p, size_t i, size_t n,
+                                 uint64_t seed) {
+  const uint64_t *s = hash_secret;
+  uint64_t a, b;
+  if (likely(n <= 16)) {
+    if (n >= 4) {
+      size_t k = (n >> 3) << 2;
+      a = (uint64_t)load32(p) << 32 | load32(p + k);
+      b = (uint64_t)load32(p + n - 4) << 32 | load32(p + n - 4 - k);
+    } else if (n > 0) {
+      const unsigned char *u = (const unsigned char *)p;
+      a = (uint64_t)u[0] << 16 | (uint64_t)u[n >> 1] << 8 | u[n - 1];
+      b = 0;
+    } else {
+      a = b = 0;
+    }
+  } else {
+    while (unlikely(i > 16)) {
+      seed = mix(load64(p) ^ s[1], load64(p + 8) ^ seed);
+      i -= 16;
+      p += 16;
+    }
+    a = load64(p + i - 16);
+    b = load64(p + i - 8);
+  }
+  a ^= s[1];
+  b ^= seed;
+  mul128(&a, &b);
+  return mix(a ^ s[0] ^ n, b ^ s[1]);
+}
+
+static uint64_t hash_bytes(const char *p, size_t n, uint64_t seed) {
+  size_t i = n;
+  seed = hash_seed(seed);
+  if (unlikely(i > 48)) {
+    uint64_t st[3] = {seed, seed, seed};
+    do {
+      hash_block(st, p);
+      p += 48;
+      i -= 48;
+    } while (likely(i > 48));
+    seed = st[0] ^ st[1] ^ st[2];
+  }
+  return hash_tail(p, i, n, seed);
+}
+
+uint64_t string_hash(const string_t *str, uint64_t seed) {
+  return hash_bytes(str->buf, str->len, seed);
+}
+
+/*
+ * The hasher buffers up to one block behind 16 bytes of history, which
+ * hash_tail() may read. A block is only mixed in once more input follows
+ * it, because hash_bytes() treats the last 1 to 48 bytes differently.
+ * Whole blocks of a large part are mixed in without being copied.
+ */
+
+#define HASHER_HISTORY 16
+
+void string_hasher_init(string_hasher_t *h, uint64_t seed) {
+  seed = hash_seed(seed);
+  h->state[0] = h->state[1] = h->state[2] = seed;
+  h->len = 0;
+  h->pending = 0;
+}
+
+void string_hasher_update(string_hasher_t *h, const char *buf, size_t len) {
+  char *pending = h->buf + HASHER_HISTORY;
+  h->len += len;
+  if (h->pending > 0 || len <= 48) {
+    size_t k = (48 - h->pending < len) ? 48 - h->pending : len;
+    memcpy(pending + h->pending, buf, k);
+    h->pending += k;
+    buf += k;
+    len -= k;
+    if (len == 0)
+      return;
+    hash_block(h->state, pending);
+    memcpy(h->buf, pending + 48 - HASHER_HISTORY, HASHER_HISTORY);
+  }
+  if (len > 48) {
+    do {
+      hash_block(h->state, buf);
+      buf += 48;
+      len -= 48;
+    } while (len > 48);
+    memcpy(h->buf, buf - HASHER_HISTORY, HASHER_HISTORY);
+  }
+  memcpy(pending, buf, len);
+  h->pending = len;
+}
+
+uint64_t string_hasher_final(const string_hasher_t *h) {
+  const uint64_t *st = h->state;
+  uint64_t seed = (h->len > 48) ? st[0] ^ st[1] ^ st[2] : st[0];
+  return hash_tail(h->buf + HASHER_HISTORY, h->pending, h->len, seed);
+}
+
+/**********************************************************************/
+
+string_t *string_colored(const char *str, enum stringcolor c) {
+  int n = strlen(str) + strlen(COLOR_DEFAULT) + strlen(COLOR_BLACK);
+  string_t *s = heap_alloc(sizeof(string_t) + n, __func__);
+  if (unlikely(s == NULL))
+    return NULL;
+  s->len = n;
+  switch (c) {
+  case BLACK:
+    memcpy(s->buf, COLOR_BLACK, strlen(COLOR_BLACK));
+    break;
+  case RED:
+    memcpy(s->buf, COLOR_RED, strlen(COLOR_RED));
+    break;
+  case GREEN:
+    memcpy(s->buf, COLOR_GREEN, strlen(COLOR_GREEN));
+    break;
+  case YELLOW:
+    memcpy(s->buf, COLOR_YELLOW, strlen(COLOR_YELLOW));
+    break;
+  case BLUE:
+    memcpy(s->buf, COLOR_BLUE, strlen(COLOR_BLUE));
+    break;
+  case MAGENTA:
+    memcpy(s->buf, COLOR_MAGENTA, strlen(COLOR_MAGENTA));
+    break;
+  case CYAN:
+    memcpy(s->buf, COLOR_CYAN, strlen(COLOR_MAGENTA));
+    break;
+  case WHITE:
+    memcpy(s->buf, COLOR_WHITE, strlen(COLOR_WHITE));
+    break;
+  default:
+    break;
+  }
+  memcpy(&(s->buf[strlen(COLOR_BLACK)]), str, strlen(str));
+  n -= strlen(COLOR_DEFAULT);
+  memcpy(&(s->buf[n]), COLOR_DEFAULT, strlen(COLOR_DEFAULT));
+  return s;
+}
+
+/*
+ * Doubles the capacity of a heap allocated array of `cap` elements of the
+ * given size. On failure the array is left untouched and false is returned.
+ */
+static bool array_grow(void **buf, size_t *cap, size_t size, const char *fn) {
+  void *t = heap_realloc(*buf, 2 * *cap * size, fn);
+  if (unlikely(t == NULL))
+    return false;
+  *buf = t;
+  *cap *= 2;
+  return true;
+}
+
+/*************************************************************************
+ *                               Arena                                   *
+ *************************************************************************/
+
+/*
+ * An arena hands out memory from large chunks by bumping a pointer.
+ * Allocations that do not fit into a chunk of the configured size get a
+ * chunk of their own, which is linked in behind the current chunk so that
+ * the rest of the current chunk is not wasted. Resetting an arena moves all
+ * chunks to a spare list in constant time; they are reused before any new
+ * chunk is allocated.
+ */
+
+#define ARENA_ALIGN 16
+#define ARENA_CHUNK_DEFAULT 65536
+
+typedef struct arena_chunk {
+  struct arena_chunk *next;
+  size_t size;
+  _Alignas(ARENA_ALIGN) char data[];
+} arena_chunk_t;
+
+struct string_arena {
+  arena_chunk_t *head;  /* chunks in use, the current one first */
+  arena_chunk_t *last;  /* last chunk in use */
+  arena_chunk_t *spare; /* chunks released by string_arena_reset() */
+  char *ptr, *end;      /* free space in the current chunk */
+  size_t chunk_size;
+};
+
+static void arena_init(string_arena_t *arena, size_t chunk_size) {
+  arena->head = arena->last = arena->spare = NULL;
+  arena->ptr = arena->end = NULL;
+  arena->chunk_size = chunk_size ? chunk_size : ARENA_CHUNK_DEFAULT;
+}
+
+string_arena_t *string_arena_create(size_t chunk_size) {
+  string_arena_t *arena = heap_alloc(sizeof(string_arena_t), __func__);
+  if (unlikely(arena == NULL))
+    return NULL;
+  arena_init(arena, chunk_size);
+  return arena;
+}
+
+static arena_chunk_t *arena_chunk(string_arena_t *arena, size_t size,
+                                  const char *fn) {
+  arena_chunk_t *c = arena->spare;
+  if (c != NULL && c->size >= size) {
+    arena->spare = c->next;
+    return c;
+  }
+  if (unlikely(size > SIZE_MAX - sizeof(arena_chunk_t)))
+    return NULL;
+  c = heap_alloc(sizeof(arena_chunk_t) + size, fn);
+  if (unlikely(c == NULL))
+    return NULL;
+  c->size = size;
+  return c;
+}
+
+void *string_arena_alloc(string_arena_t *arena, size_t size) {
+  if (unlikely(size > SIZE_MAX - (ARENA_ALIGN - 1)))
+    return NULL;
+  size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+  if (unlikely(size == 0))
+    size = ARENA_ALIGN;
+  if (likely(size <= (size_t)(arena->end - arena->ptr))) {
+    void *p = arena->ptr;
+    arena->ptr += size;
+    return p;
+  }
+
+  if (size > arena->chunk_size / 4 && arena->head != NULL) {
+    arena_chunk_t *c = arena_chunk(arena, size, __func__);
+    if (unlikely(c == NULL))
+      return NULL;
+    c->next = arena->head->next;
+    arena->head->next = c;
+    if (arena->last == arena->head)
+      arena->last = c;
+    return c->data;
+  }
+
+  size_t n = (size > arena->chunk_size) ? size : arena->chunk_size;
+  arena_chunk_t *c = arena_chunk(arena, n, __func__);
+  if (unlikely(c == NULL))
+    return NULL;
+  c->next = arena->head;
+  arena->head = c;
+  if (arena->last == NULL)
+    arena->last = c;
+  arena->ptr = c->data + size;
+  arena->end = c->data + c->size;
+  return c->data;
+}
+
+void string_arena_reset(string_arena_t *arena) {
+  if (arena->head != NULL) {
+    arena->last->next = arena->spare;
+    arena->spare = arena->head;
+  }
+  arena->head = arena->last = NULL;
+  arena->ptr = arena->end = NULL;
+}
+
+/* Frees the chunks of an arena, but not the arena itself. */
+static void arena_release(string_arena_t *arena) {
+  string_arena_reset(arena);
+  for (arena_chunk_t *c = arena->spare, *next; c != NULL; c = next) {
+    next = c->next;
+    heap_free(c);
+  }
+}
+
+void string_arena_free(string_arena_t *arena) {
+  arena_release(arena);
+  heap_free(arena);
+}
+
+/*
+ * Allocates from the arena if one is given and from the heap otherwise.
+ * Every function that has an arena variant allocates through here. Heap
+ * allocations are counted for the function `fn`.
+ */
+static inline void *mem_alloc(string_arena_t *arena, size_t size,
+                              const char *fn) {
+  return arena ? string_arena_alloc(arena, size) : heap_alloc(size, fn);
+}
+
+static inline string_t *string_alloc(string_arena_t *arena, size_t len,
+                                     const char *fn) {
+  string_t *s = mem_alloc(arena, sizeof(string_t) + len, fn);
+  if (likely(s != NULL))
+    s->len = len;
+  return s;
+}
+
+static string_t *string_dup(string_arena_t *arena, const char *str,
+                            size_t len, const char *fn) {
+  string_t *s = string_alloc(arena, len, fn);
+  if (unlikely(s == NULL))
+    return NULL;
+  memcpy(s->buf, str, len);
+  return s;
+}
+
+/**********************************************************************/
+
+string_t *string_arena_nnew(string_arena_t *arena, const char *str,
+                            size_t len) {
+  return string_dup(arena, str, len, __func__);
+}
+
+string_t *string_nnew(const char *str, size_t len) {
+  return string_dup(NULL, str, len, __func__);
+}
+
+/**********************************************************************/
+
+string_t *string_arena_new(string_arena_t *arena, const char *str) {
+  return string_dup(arena, str, strlen(str), __func__);
+}
+
+string_t *string_new(const char *str) {
+  return string_dup(NULL, str, strlen(str), __func__);
+}
+
+/**********************************************************************/
+
+string_t *string_arena_clone(string_arena_t *arena, const string_t *str) {
+  return string_dup(arena, str->buf, str->len, __func__);
+}
+
+string_t *string_clone(const string_t *str) {
+  return string_dup(NULL, str->buf, str->len, __func__);
+}
+
+/**********************************************************************/
+
+/*
+ * Reads until end of file directly into the result string. For regular
+ * files the remaining size is known from fstat(), so the string is
+ * allocated once with one spare byte, which lets the final read() that
+ * detects end of file succeed without growing the buffer.
+ */
+string_t *string_readfd(int fd) {
+  size_t cap = BUF_LEN, len = 0;
+  struct stat st;
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+    off_t pos = lseek(fd, 0, SEEK_CUR);
+    if (pos >= 0 && st.st_size > pos)
+      cap = (size_t)(st.st_size - pos) + 1;
+  }
+
+  string_t *s = string_alloc(NULL, cap, __func__);
+  if (unlikely(s == NULL))
+    return NULL;
+  for (;;) {
+    if (len == cap) {
+      string_t *t = heap_realloc(s, sizeof(string_t) + 2 * cap, __func__);
+      if (unlikely(t == NULL)) {
+        heap_free(s);
+        return NULL;
+      }
+      s = t;
+      cap *= 2;
+    }
+    ssize_t n = read(fd, s->buf + len, cap - len);
+    if (n == 0)
+      break;
+    if (unlikely(n < 0)) {
+      if (errno == EINTR)
+        continue;
+      heap_free(s);
+      return string_dup(NULL, "", 0, __func__);
+    }
+    len += n;
+  }
+
+  if (len < cap) {
+    string_t *t = heap_realloc(s, sizeof(string_t) + len, __func__);
+    if (likely(t != NULL))
+      s = t;
+  }
+  s->len = len;
+  return s;
+}
+
+/**********************************************************************/
+
+string_t *string_readline(FILE *stream) {
+  char *line = NULL;
+  size_t cap = 0;
+  ssize_t n = getline(&line, &cap, stream);
+  string_t *s;
+  if (n <= 0)
+    s = string_dup(NULL, "", 0, __func__);
+  else
+    s = string_dup(NULL, line, n - (line[n - 1] == '\n'), __func__);
+  free(line);
+  return s;
+}
+
+/**********************************************************************/
+
+static string_t *concat(string_arena_t *arena, const string_t *s1,
+                        const string_t *s2, const char *fn) {
+  string_t *s = string_alloc(arena, s1->len + s2->len, fn);
+  if (unlikely(s == NULL))
+    return NULL;
+  memcpy(s->buf, s1->buf, s1->len);
+  memcpy(s->buf + s1->len, s2->buf, s2->len);
+  return s;
+}
+
+string_t *string_arena_concat(string_arena_t *arena, const string_t *s1,
+                              const string_t *s2) {
+  return concat(arena, s1, s2, __func__);
+}
+
+string_t *string_concat(const string_t *s1, const string_t *s2) {
+  return concat(NULL, s1, s2, __func__);
+}
+
+/**********************************************************************/
+
+/*
+ * Computes the bounds [*l, *r) of buf without surrounding whitespace. Most
+ * strings neither start nor end with whitespace, so the kernels are only
+ * called when the first or last byte is.
+ */
+static void trim_bounds(const char *buf, size_t len, size_t *l, size_t *r) {
+  size_t a = 0, b = len;
+  if (a < b && is_space(buf[a]))
+    a = kernels()->space_prefix(buf, len);
+  if (a < b && is_space(buf[b - 1]))
+    b = a + kernels()->space_suffix(buf + a, b - a);
+  *l = a;
+  *r = b;
+}
+
+string_t *string_arena_trim(string_arena_t *arena, const string_t *str) {
+  size_t l, r;
+  trim_bounds(str->buf, str->len, &l, &r);
+  return string_dup(arena, &(str->buf[l]), r - l, __func__);
+}
+
+string_t *string_trim(const string_t *str) {
+  size_t l, r;
+  trim_bounds(str->buf, str->len, &l, &r);
+  return string_dup(NULL, &(str->buf[l]), r - l, __func__);
+}
+
+/**********************************************************************/
+
+string_t *string_map(charfunc_t fun, const string_t *str) {
+  string_t *s = string_alloc(NULL, str->len, __func__);
+  if (unlikely(s == NULL))
+    return NULL;
+  for (size_t i = 0; i < s->len; i++) {
+    s->buf[i] = fun(str->buf[i]);
+  }
+  return s;
+}
+
+string_t *string_map_table(const string_t *str, const char table[256]) {
+  string_t *s = string_alloc(NULL, str->len, __func__);
+  if (unlikely(s == NULL))
+    return NULL;
+  kernels()->translate(s->buf, str->buf, str->len, table);
+  return s;
+}
+
+/**********************************************************************/
+
+/* Returns the string s, reallocated to fit s->len if that is smaller. */
+static string_t *string_shrink(string_t *s, size_t cap, const char *fn) {
+  if (s->len < cap) {
+    string_t *t = heap_realloc(s, sizeof(string_t) + s->len, fn);
+    if (likely(t != NULL))
+      s = t;
+  }
+  return s;
+}
+
+string_t *string_filter(boolfunc_t fun, const string_t *str) {
+  string_t *s = string_alloc(NULL, str->len, __func__);
+  if (unlikely(s == NULL))
+    return NULL;
+  size_t k = 0;
+  for (size_t i = 0; i < str->len; i++)
+    if (fun(str->buf[i]))
+      s->buf[k++] = str->buf[i];
+  s->len = k;
+  return string_shrink(s, str->len, __func__);
+}
+
+string_t *string_filter_set(const string_t *str, const uint64_t set[4]) {
+  byteset_t bs;
+  byteset_init_bits(&bs, set);
+  string_t *s = string_alloc(NULL, str->len, __func__);
+  if (unlikely(s == NULL))
+    return NULL;
+  s->len = kernels()->select(s->buf, str->buf, str->len, &bs);
+  return string_shrink(s, str->len, __func__);
+}
+
+/**********************************************************************/
+
+int string_compare(const string_t *s1, const string_t *s2) {
+  return bytes_compare(s1->buf, s1->len, s2->buf, s2->len);
+}
+
+/**********************************************************************/
+
+bool string_equal(const string_t *s1, const string_t *s2) {
+  return s1->len == s2->len && bytes_equal(s1->buf, s2->buf, s1->len);
+}
+
+/**********************************************************************/
+
+string_hashed_t string_hashed(const string_t *str) {
+  return (string_hashed_t){str, string_hash(str, 0)};
+}
+
+bool string_hashed_equal(string_hashed_t a, string_hashed_t b) {
+  return a.hash == b.hash && string_equal(a.str, b.str);
+}
+
+/**********************************************************************/
+
+string_t *string_arena_substring(string_arena_t *arena, const string_t *str,
+                                 size_t start, size_t end) {
+  if (unlikely(start > end || end > str->len))
+    return NULL;
+
+  return string_dup(arena, &(str->buf[start]), end - start, __func__);
+}
+
+string_t *string_substring(const string_t *str, size_t start, size_t end) {
+  if (unlikely(start > end || end > str->len))
+    return NULL;
+
+  return string_dup(NULL, &(str->buf[start]), end - start, __func__);
+}
+
+/**********************************************************************/
+
+string_t *string_repeat(const string_t *str, size_t times) {
+  size_t n = str->len * times;
+  if (unlikely(!n))
+    return string_dup(NULL, "", 0, __func__);
+
+  string_t *s = string_alloc(NULL, n, __func__);
+  if (unlikely(!s))
+    return NULL;
+
+  for (size_t i = 0; i < times; i++)
+    memcpy(&(s->buf[i * (str->len)]), str->buf, str->len);
+
+  return s;
+}
+
+/**********************************************************************/
+
+char *string_tocstr(const string_t *str) {
+  char *cstr = heap_alloc(str->len + 1, __func__);
+  if (unlikely(cstr == NULL))
+    return NULL;
+  memcpy(cstr, str->buf, str->len);
+  cstr[str->len] = '\0';
+  return cstr;
+}
+
+/**********************************************************************/
+
+/*
+ * Substring search engine.
+ *
+ * The common case is handled by a filter that compares the first and last
+ * byte of the needle against 16 (SSE2) or 32 (AVX2) haystack positions at
+ * once and verifies the surviving candidates with memcmp(). The filter is
+ * quadratic in the worst case, so it keeps track of the bytes spent on
+ * verification and hands over to the Two-Way algorithm of Crochemore and
+ * Perrin once that cost outgrows the scanned input. Two-Way runs in linear
+ * time and constant space.
+ */
+
+#define NPOS ((size_t)-1)
+
+typedef struct {
+  size_t ell; /* critical position of the needle */
+  size_t per; /* period, or the shift used for non-periodic needles */
+  bool periodic;
+} twoway_t;
+
+static size_t maximal_suffix(const unsigned char *x, size_t m, size_t *period,
+                             bool reverse) {
+  size_t ms = NPOS, j = 0, k = 1, p = 1;
+  while (j + k < m) {
+    unsigned char a = x[j + k];
+    unsigned char b = x[ms + k];
+    if (reverse ? a > b : a < b) {
+      j += k;
+      k = 1;
+      p = j - ms;
+    } else if (a == b) {
+      if (k != p) {
+        k += 1;
+      } else {
+        j += p;
+        k = 1;
+      }
+    } else {
+      ms = j++;
+      k = p = 1;
+    }
+  }
+  *period = p;
+  return ms;
+}
+
+static void twoway_init(twoway_t *tw, const unsigned char *x, size_t m) {
+  size_t p1, p2;
+  size_t s1 = maximal_suffix(x, m, &p1, false);
+  size_t s2 = maximal_suffix(x, m, &p2, true);
+
+  if (s1 + 1 > s2 + 1) {
+    tw->ell = s1 + 1;
+    tw->per = p1;
+  } else {
+    tw->ell = s2 + 1;
+    tw->per = p2;
+  }
+
+  tw->periodic = tw->ell + tw->per <= m &&
+                 memcmp(x, x + tw->per, tw->ell) == 0;
+  if (!tw->periodic)
+    tw->per = ((tw->ell > m - tw->ell) ? tw->ell : m - tw->ell) + 1;
+}
+
+static size_t twoway_search(const twoway_t *tw, const unsigned char *h,
+                            size_t n, const unsigned char *x, size_t m) {
+  size_t ell = tw->ell, j = 0, i;
+
+  if (tw->periodic) {
+    size_t memory = 0;
+    while (j <= n - m) {
+      i = (ell > memory) ? ell : memory;
+      while (i < m && x[i] == h[i + j])
+        i += 1;
+      if (i < m) {
+        j += i - ell + 1;
+        memory = 0;
+        continue;
+      }
+      i = ell;
+      while (i > memory && x[i - 1] == h[i - 1 + j])
+        i -= 1;
+      if (i <= memory)
+        return j;
+      j += tw->per;
+      memory = m - tw->per;
+    }
+  } else {
+    while (j <= n - m) {
+      i = ell;
+      while (i < m && x[i] == h[i + j])
+        i += 1;
+      if (i < m) {
+        j += i - ell + 1;
+        continue;
+      }
+      i = ell;
+      while (i > 0 && x[i - 1] == h[i - 1 + j])
+        i -= 1;
+      if (i == 0)
+        return j;
+      j += tw->per;
+    }
+  }
+  return NPOS;
+}
+
+/*
+ * A finder bundles everything the scan needs to know about a needle: the
+ * offsets of its two rarest bytes, which drive the SIMD filter, and the
+ * Two-Way factorization used when the filter degenerates.
+ */
+typedef struct {
+  const unsigned char *x;
+  size_t m;
+  size_t r1, r2; /* offsets of the two rarest bytes of x, r1 != r2 */
+  bool compiled; /* tw is valid */
+  twoway_t tw;
+} finder_t;
+
+/*
+ * Approximate frequency of each byte in text and log data; larger means
+ * more common. Bytes that do not appear in the table rank below all others.
+ */
+static int byte_rank(unsigned char c) {
+  static const char common[] = "~^`|\\@#$%&*+!?<>[]{};'\"\t()=\n:_/-,."
+                               "ZQJXKVBYWGPFMUCDLHRSNIOATE"
+                               "9876543210"
+                               "zqjxkvbygwpfmucdlhrsnioate ";
+  const char *p = memchr(common, c, sizeof(common) - 1);
+  return p ? (int)(p - common) + 1 : 0;
+}
+
+static void finder_init(finder_t *f, const unsigned char *x, size_t m) {
+  f->x = x;
+  f->m = m;
+  f->r1 = 0;
+  f->r2 = (m > 1) ? m - 1 : 0;
+  f->compiled = false;
+  if (m < 2)
+    return;
+
+  int k1 = byte_rank(x[f->r1]), k2 = byte_rank(x[f->r2]);
+  for (size_t i = 1; i + 1 < m; i++) {
+    int k = byte_rank(x[i]);
+    if (k < k1) {
+      if (k1 < k2) {
+        f->r2 = f->r1;
+        k2 = k1;
+      }
+      f->r1 = i;
+      k1 = k;
+    } else if (k < k2) {
+      f->r2 = i;
+      k2 = k;
+    }
+  }
+}
+
+static void finder_compile(finder_t *f) {
+  if (f->m >= 2)
+    twoway_init(&f->tw, f->x, f->m);
+  f->compiled = true;
+}
+
+/*
+ * The filters below scan h[*pos..] for the needle (m >= 2). They return
+ * the offset of the first match, or NPOS. In the latter case *pos is set
+ * to n - m + 1 if the haystack was exhausted, or to the first unscanned
+ * position if verification became too expensive.
+ */
+
+#define FILTER_BUDGET(scanned) (4 * (scanned) + 1024)
+
+static size_t filter_scalar(const finder_t *f, const unsigned char *h,
+                            size_t n, size_t *pos) {
+  const unsigned char *x = f->x;
+  size_t m = f->m, r1 = f->r1, r2 = f->r2;
+  size_t start = *pos, last = n - m, cost = 0;
+
+  for (size_t i = start; i <= last; i++) {
+    const unsigned char *p = memchr(h + i + r1, x[r1], last - i + 1);
+    if (!p)
+      break;
+    i = p - h - r1;
+    if (h[i + r2] != x[r2])
+      continue;
+    if (memcmp(h + i, x, m) == 0)
+      return i;
+    cost += m;
+    if (unlikely(cost > FILTER_BUDGET(i - start))) {
+      *pos = i + 1;
+      return NPOS;
+    }
+  }
+  *pos = last + 1;
+  return NPOS;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+__attribute__((target("avx2"))) static size_t
+filter_avx2(const finder_t *f, const unsigned char *h, size_t n, size_t *pos) {
+  const unsigned char *x = f->x;
+  size_t m = f->m, r1 = f->r1, r2 = f->r2;
+  const __m256i v1 = _mm256_set1_epi8((char)x[r1]);
+  const __m256i v2 = _mm256_set1_epi8((char)x[r2]);
+  size_t start = *pos, i = start, cost = 0;
+
+  for (; i + 32 <= n - m + 1; i += 32) {
+    __m256i a = _mm256_loadu_si256((const __m256i *)(h + i + r1));
+    __m256i b = _mm256_loadu_si256((const __m256i *)(h + i + r2));
+    uint32_t mask = (uint32_t)_mm256_movemask_epi8(
+        _mm256_and_si256(_mm256_cmpeq_epi8(a, v1), _mm256_cmpeq_epi8(b, v2)));
+    for (; mask; mask &= mask - 1) {
+      size_t j = i + __builtin_ctz(mask);
+      if (memcmp(h + j, x, m) == 0)
+        return j;
+      cost += m;
+    }
+    if (unlikely(cost > FILTER_BUDGET(i - start))) {
+      *pos = i + 32;
+      return NPOS;
+    }
+  }
+  *pos = i;
+  return filter_scalar(f, h, n, pos);
+}
+
+#endif
+
+#if defined(__SSE2__)
+
+static size_t filter_sse2(const finder_t *f, const unsigned char *h, size_t n,
+                          size_t *pos) {
+  const unsigned char *x = f->x;
+  size_t m = f->m, r1 = f->r1, r2 = f->r2;
+  const __m128i v1 = _mm_set1_epi8((char)x[r1]);
+  const __m128i v2 = _mm_set1_epi8((char)x[r2]);
+  size_t start = *pos, i = start, cost = 0;
+
+  for (; i + 16 <= n - m + 1; i += 16) {
+    __m128i a = _mm_loadu_si128((const __m128i *)(h + i + r1));
+    __m128i b = _mm_loadu_si128((const __m128i *)(h + i + r2));
+    uint32_t mask = (uint32_t)_mm_movemask_epi8(
+        _mm_and_si128(_mm_cmpeq_epi8(a, v1), _mm_cmpeq_epi8(b, v2)));
+    for (; mask; mask &= mask - 1) {
+      size_t j = i + __builtin_ctz(mask);
+      if (memcmp(h + j, x, m) == 0)
+        return j;
+      cost += m;
+    }
+    if (unlikely(cost > FILTER_BUDGET(i - start))) {
+      *pos = i + 16;
+      return NPOS;
+    }
+  }
+  *pos = i;
+  return filter_scalar(f, h, n, pos);
+}
+
+#endif
+
+static size_t filter(const finder_t *f, const unsigned char *h, size_t n,
+                     size_t *pos) {
+#if defined(__x86_64__) || defined(__i386__)
+  if (isa() >= LIBSTRING_ISA_AVX2)
+    return filter_avx2(f, h, n, pos);
+#endif
+#if defined(__SSE2__)
+  if (isa() >= LIBSTRING_ISA_SSE2)
+    return filter_sse2(f, h, n, pos);
+#endif
+  return filter_scalar(f, h, n, pos);
+}
+
+/* Returns the offset of the first match of the needle in h[from..n). */
+static size_t finder_find(const finder_t *f, const char *hay, size_t n,
+                          size_t from) {
+  const unsigned char *h = (const unsigned char *)hay;
+  size_t m = f->m;
+
+  if (unlikely(from > n))
+    return NPOS;
+  if (unlikely(m == 0))
+    return from;
+  if (m > n - from)
+    return NPOS;
+  if (m == 1) {
+    const unsigned char *p = memchr(h + from, f->x[0], n - from);
+    return p ? (size_t)(p - h) : NPOS;
+  }
+
+  size_t pos = from;
+  size_t r = filter(f, h, n, &pos);
+  if (r != NPOS || pos > n - m)
+    return r;
+
+  twoway_t tw;
+  if (!f->compiled)
+    twoway_init(&tw, f->x, m);
+  r = twoway_search(f->compiled ? &f->tw : &tw, h + pos, n - pos, f->x, m);
+  return (r == NPOS) ? NPOS : r + pos;
+}
+
+static size_t search(const char *hay, size_t n, const char *needle, size_t m,
+                     size_t from) {
+  finder_t f;
+  finder_init(&f, (const unsigned char *)needle, m);
+  return finder_find(&f, hay, n, from);
+}
+
+static int string_substring_index_offset(const string_t *str,
+                                         const string_t *substring,
+                                         size_t offset) {
+  size_t r = search(str->buf, str->len, substring->buf, substring->len, offset);
+  return (r == NPOS) ? -1 : (int)r;
+}
+
+int string_substring_index(const string_t *str, const string_t *substring) {
+  return string_substring_index_offset(str, substring, 0);
+}
+
+/**********************************************************************/
+
+struct string_needle {
+  finder_t f;
+  size_t len;
+  unsigned char buf[];
+};
+
+string_needle_t *string_needle_new(const string_t *str) {
+  string_needle_t *needle =
+      heap_alloc(sizeof(string_needle_t) + str->len, __func__);
+  if (unlikely(needle == NULL))
+    return NULL;
+  needle->len = str->len;
+  memcpy(needle->buf, str->buf, str->len);
+  finder_init(&needle->f, needle->buf, needle->len);
+  finder_compile(&needle->f);
+  return needle;
+}
+
+int string_needle_find(const string_needle_t *needle, const string_t *str) {
+  size_t r = finder_find(&needle->f, str->buf, str->len, 0);
+  return (r == NPOS) ? -1 : (int)r;
+}
+
+size_t string_needle_count(const string_needle_t *needle,
+                           const string_t *str) {
+  size_t n = 0, step = (needle->len) ? needle->len : 1;
+  size_t r = finder_find(&needle->f, str->buf, str->len, 0);
+  while (r != NPOS) {
+    n += 1;
+    r = finder_find(&needle->f, str->buf, str->len, r + step);
+  }
+  return n;
+}
+
+size_t *string_needle_find_all(const string_needle_t *needle,
+                               const string_t *str, size_t *count) {
+  size_t n = 0, cap = CAP_DEFAULT, step = (needle->len) ? needle->len : 1;
+  size_t *offsets = heap_alloc(cap * sizeof(size_t), __func__);
+  if (unlikely(offsets == NULL))
+    return NULL;
+
+  size_t r = finder_find(&needle->f, str->buf, str->len, 0);
+  while (r != NPOS) {
+    if (n == cap && unlikely(!array_grow((void **)&offsets, &cap,
+                                         sizeof(size_t), __func__))) {
+      heap_free(offsets);
+      return NULL;
+    }
+    offsets[n++] = r;
+    r = finder_find(&needle->f, str->buf, str->len, r + step);
+  }
+  *count = n;
+  return offsets;
+}
+
+/**********************************************************************/
+
+bool string_is_substring(const string_t *str, const string_t *sub, size_t off) {
+  if (unlikely(sub->len + off > str->len))
+    return false;
+  if (unlikely(sub->len == 0))
+    return true;
+  return strncmp(&(str->buf[off]), sub->buf, sub->len) ? false : true;
+}
+
+/**********************************************************************/
+
+string_t *string_replace_char(const string_t *str, char old, char new) {
+  string_t *s = string_alloc(NULL, str->len, __func__);
+  if (unlikely(s == NULL))
+    return NULL;
+
+  kernels()->replace(s->buf, str->buf, str->len, old, new);
+  return s;
+}
+
+size_t string_count_char(const string_t *str, char c) {
+  return kernels()->count(str->buf, str->len, c);
+}
+
+int string_find_char(const string_t *str, char c) {
+  size_t i = kernels()->find(str->buf, str->len, c);
+  return (i < str->len) ? (int)i : -1;
+}
+
+int string_find_any_of(const string_t *str, const string_t *set) {
+  byteset_t s;
+  byteset_init(&s, set->buf, set->len);
+  size_t i = kernels()->find_set(str->buf, str->len, &s);
+  return (i < str->len) ? (int)i : -1;
+}
+
+/**********************************************************************/
+
+/*
+ * string_replace() searches the input once and records the match offsets,
+ * first in a small buffer on the stack and then on the heap. The result is
+ * assembled from the recorded offsets without searching again.
+ */
+
+#define INLINE_MATCHES 64
+
+string_t *string_replace(const string_t *str, const string_t *old,
+                         const string_t *new) {
+  if (unlikely(old->len == 0))
+    return string_dup(NULL, str->buf, str->len, __func__);
+
+  size_t inline_offsets[INLINE_MATCHES];
+  size_t *offsets = inline_offsets, n = 0, cap = INLINE_MATCHES;
+  string_t *s = NULL;
+  finder_t f;
+  finder_init(&f, (const unsigned char *)old->buf, old->len);
+
+  size_t r = finder_find(&f, str->buf, str->len, 0);
+  for (; r != NPOS; r = finder_find(&f, str->buf, str->len, r + old->len)) {
+    if (n == cap) {
+      if (offsets == inline_offsets) {
+        offsets = heap_alloc(2 * cap * sizeof(size_t), __func__);
+        if (unlikely(offsets == NULL))
+          return NULL;
+        memcpy(offsets, inline_offsets, sizeof(inline_offsets));
+        cap *= 2;
+      } else if (unlikely(!array_grow((void **)&offsets, &cap,
+                                      sizeof(size_t), __func__))) {
+        goto out;
+      }
+    }
+    offsets[n++] = r;
+  }
+
+  if (n == 0)
+    return string_dup(NULL, str->buf, str->len, __func__);
+
+  size_t len = str->len - n * old->len + n * new->len;
+  s = string_alloc(NULL, len, __func__);
+  if (unlikely(s == NULL))
+    goto out;
+
+  char *t = s->buf;
+  size_t curr = 0;
+  for (size_t i = 0; i < n; i++) {
+    memcpy(t, str->buf + curr, offsets[i] - curr);
+    t += offsets[i] - curr;
+    memcpy(t, new->buf, new->len);
+    t += new->len;
+    curr = offsets[i] + old->len;
+  }
+  memcpy(t, str->buf + curr, str->len - curr);
+
+out:
+  if (offsets != inline_offsets)
+    heap_free(offsets);
+  return s;
+}
+
+/**********************************************************************/
+
+/*
+ * Delimiter scanning. byte_mask() returns a bit mask of the positions of a
+ * byte in a block of up to 64 bytes, so that consecutive delimiters are
+ * found by clearing the lowest set bit rather than by a call per field.
+ */
+
+static uint64_t byte_mask_scalar(const char *p, size_t n, char c) {
+  uint64_t mask = 0;
+  for (size_t i = 0; i < n; i++)
+    mask |= (uint64_t)(p[i] == c) << i;
+  return mask;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+__attribute__((target("avx2"))) static uint64_t
+byte_mask_avx2(const char *p, char c) {
+  const __m256i v = _mm256_set1_epi8(c);
+  __m256i a = _mm256_loadu_si256((const __m256i *)p);
+  __m256i b = _mm256_loadu_si256((const __m256i *)(p + 32));
+  uint32_t lo = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, v));
+  uint32_t hi = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(b, v));
+  return (uint64_t)hi << 32 | lo;
+}
+
+__attribute__((target("avx512f,avx512bw"))) static uint64_t
+byte_mask_avx512(const char *p, char c) {
+  __m512i a = _mm512_loadu_si512((const void *)p);
+  return _mm512_cmpeq_epi8_mask(a, _mm512_set1_epi8(c));
+}
+
+#endif
+
+#if defined(__SSE2__)
+
+static uint64_t byte_mask_sse2(const char *p, char c) {
+  const __m128i v = _mm_set1_epi8(c);
+  uint64_t mask = 0;
+  for (int i = 0; i < 64; i += 16) {
+    __m128i a = _mm_loadu_si128((const __m128i *)(p + i));
+    mask |= (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(a, v)) << i;
+  }
+  return mask;
+}
+
+#endif
+
+static inline uint64_t byte_mask(const char *p, size_t n, char c) {
+  if (unlikely(n < 64))
+    return byte_mask_scalar(p, n, c);
+#if defined(__x86_64__) || defined(__i386__)
+  if (isa() >= LIBSTRING_ISA_AVX512)
+    return byte_mask_avx512(p, c);
+  if (isa() >= LIBSTRING_ISA_AVX2)
+    return byte_mask_avx2(p, c);
+#endif
+#if defined(__SSE2__)
+  if (isa() >= LIBSTRING_ISA_SSE2)
+    return byte_mask_sse2(p, c);
+#endif
+  return byte_mask_scalar(p, 64, c);
+}
+
+static size_t count_byte(const char *p, size_t n, char c) {
+  return kernels()->count(p, n, c);
+}
+
+string_split_iter_t string_split_iter(string_view_t v, char delimiter) {
+  return (string_split_iter_t){v.buf, v.len, 0, 0,
+                               v.len ? byte_mask(v.buf, v.len, delimiter) : 0,
+                               delimiter, false};
+}
+
+bool string_split_next(string_split_iter_t *it, string_view_t *field) {
+  while (it->mask == 0) {
+    if (it->block + 64 >= it->len) {
+      if (it->done)
+        return false;
+      *field = (string_view_t){it->len - it->start, it->buf + it->start};
+      it->done = true;
+      return true;
+    }
+    it->block += 64;
+    it->mask =
+        byte_mask(it->buf + it->block, it->len - it->block, it->delimiter);
+  }
+  size_t pos = it->block + __builtin_ctzll(it->mask);
+  it->mask &= it->mask - 1;
+  *field = (string_view_t){pos - it->start, it->buf + it->start};
+  it->start = pos + 1;
+  return true;
+}
+
+/**********************************************************************/
+
+static string_vector_t *vector_alloc(string_arena_t *arena, size_t cap,
+                                     const char *fn);
+
+/* Counts the fields first, so that the vector is allocated only once. */
+static string_vector_t *split(string_arena_t *arena, const string_t *str,
+                              char delimiter, const char *fn) {
+  size_t n = count_byte(str->buf, str->len, delimiter) + 1;
+  string_vector_t *svec = vector_alloc(arena, n, fn);
+  if (unlikely(svec == NULL))
+    return NULL;
+  string_split_iter_t it = string_split_iter(string_view(str), delimiter);
+  string_view_t v;
+  while (string_split_next(&it, &v))
+    string_vector_add(svec, string_dup(arena, v.buf, v.len, fn));
+  return svec;
+}
+
+string_vector_t *string_arena_split(string_arena_t *arena, const string_t *str,
+                                    char delimiter) {
+  return split(arena, str, delimiter, __func__);
+}
+
+string_vector_t *string_split(const string_t *str, char delimiter) {
+  return split(NULL, str, delimiter, __func__);
+}
+
+/**********************************************************************/
+
+/*
+ * Yields the field of buf[0, n) that starts at *start and advances *start
+ * past the delimiter that ends it. The last field ends at n and is marked
+ * by setting *start to NPOS.
+ */
+static string_view_t ssplit_field(const finder_t *f, const char *buf,
+                                  size_t n, size_t *start, size_t *splits) {
+  size_t r = (*splits && f->m) ? finder_find(f, buf, n, *start) : NPOS;
+  string_view_t v = {((r == NPOS) ? n : r) - *start, buf + *start};
+  if (r == NPOS) {
+    *start = NPOS;
+  } else {
+    *start = r + f->m;
+    *splits -= 1;
+  }
+  return v;
+}
+
+string_vector_t *string_ssplit_n(const string_t *str, const string_t *delimiter,
+                                 size_t max_splits) {
+  string_vector_t *svec = vector_alloc(NULL, CAP_DEFAULT, __func__);
+  if (unlikely(svec == NULL))
+    return NULL;
+  finder_t f;
+  finder_init(&f, (const unsigned char *)delimiter->buf, delimiter->len);
+  finder_compile(&f);
+
+  size_t start = 0;
+  while (start != NPOS) {
+    string_view_t v = ssplit_field(&f, str->buf, str->len, &start, &max_splits);
+    string_vector_add(svec, string_dup(NULL, v.buf, v.len, __func__));
+  }
+  return svec;
+}
+
+string_vector_t *string_ssplit(const string_t *str, const string_t *delimiter) {
+  return string_ssplit_n(str, delimiter, STRING_SPLIT_ALL);
+}
+
+string_ssplit_iter_t string_ssplit_iter(string_view_t v,
+                                        const string_needle_t *delimiter,
+                                        size_t max_splits) {
+  return (string_ssplit_iter_t){v.buf, v.len, 0, max_splits, delimiter, false};
+}
+
+bool string_ssplit_next(string_ssplit_iter_t *it, string_view_t *field) {
+  if (it->done)
+    return false;
+  *field = ssplit_field(&it->delimiter->f, it->buf, it->len, &it->start,
+                        &it->splits);
+  it->done = it->start == NPOS;
+  return true;
+}
+
+/*************************************************************************
+ *                           String Vector                               *
+ *************************************************************************/
+
+static string_vector_t *vector_alloc(string_arena_t *arena, size_t cap,
+                                     const char *fn) {
+  string_vector_t *svec = mem_alloc(arena, sizeof(string_vector_t), fn);
+  if (unlikely(svec == NULL))
+    return NULL;
+  svec->buf = mem_alloc(arena, cap * sizeof(string_t *), fn);
+  if (unlikely(svec->buf == NULL)) {
+    if (!arena)
+      heap_free(svec);
+    return NULL;
+  }
+  svec->cap = cap;
+  svec->top = -1;
+  svec->arena = arena;
+  svec->index = NULL;
+  return svec;
+}
+
+string_vector_t *string_arena_vector_empty(string_arena_t *arena) {
+  return vector_alloc(arena, CAP_DEFAULT, __func__);
+}
+
+string_vector_t *string_vector_empty() {
+  return vector_alloc(NULL, CAP_DEFAULT, __func__);
+}
+
+string_vector_t *string_vector_new(string_t *str) {
+  string_vector_t *svec = vector_alloc(NULL, CAP_DEFAULT, __func__);
+  if (unlikely(svec == NULL))
+    return NULL;
+  string_vector_add(svec, str);
+  return svec;
+}
+
+bool string_vector_is_empty(const string_vector_t *svec) {
+  return svec->top == -1;
+}
+
+void string_vector_free(string_vector_t *svec) {
+  if (svec->arena)
+    return;
+  string_vector_unindex(svec);
+  heap_free(svec->buf);
+  heap_free(svec);
+}
+
+void string_vector_deepfree(string_vector_t *svec) {
+  if (svec->arena)
+    return;
+  for (int i = 0; i <= svec->top; i++)
+    heap_free(svec->buf[i]);
+  string_vector_free(svec);
 }
 
 bool string_vector_is_full(string_vector_t *svec) {
   return (size_t)(svec->top + 1) == svec->cap;
 }
 
-void string_vector_resize(string_vector_t *svec) {
-  svec->buf = realloc(svec->buf, 2 * svec->cap * sizeof(string_t *));
-  svec->cap *= 2;
+bool string_vector_resize(string_vector_t *svec) {
+  if (!svec->arena)
+    return array_grow((void **)&svec->buf, &svec->cap, sizeof(string_t *),
+                      __func__);
+
+  string_t **buf =
+      string_arena_alloc(svec->arena, 2 * svec->cap * sizeof(string_t *));
+  if (unlikely(buf == NULL))
+    return false;
+  memcpy(buf, svec->buf, svec->cap * sizeof(string_t *));
+  svec->buf = buf;
+  svec->cap *= 2;
+  return true;
+}
+
+/*
+ * The optional hash index of a vector is a linear probing table holding
+ * the first occurrence of every distinct string. A slot stores the upper
+ * half of the string's hash, which also selects its home slot, and its
+ * index plus 1; 0 marks an empty slot. The table is built when the index
+ * is attached, so that lookups only read it and may run concurrently, and
+ * is kept at most 3/4 full. Erasing a slot shifts the rest of its probe
+ * sequence back instead of leaving a tombstone. Functions that move many
+ * elements rebuild the table. If building it fails, lookups scan the
+ * vector until string_vector_index() succeeds.
+ */
+
+#define INDEX_CAP_MIN 16
+
+typedef struct {
+  uint32_t tag;
+  uint32_t pos;
+} index_slot_t;
+
+struct string_vector_index {
+  index_slot_t *slots; /* NULL if building the table failed */
+  size_t mask;         /* the number of slots minus 1 */
+  size_t len;          /* the number of distinct strings */
+  uint64_t seed;
+};
+
+static inline uint32_t index_tag(const struct string_vector_index *ix,
+                                 const string_t *str) {
+  return hash_bytes(str->buf, str->len, ix->seed) >> 32;
+}
+
+/*
+ * The slot of the first occurrence of str, or the empty slot ending its
+ * probe sequence.
+ */
+static size_t index_slot(const string_vector_t *svec, const string_t *str,
+                         uint32_t tag) {
+  const struct string_vector_index *ix = svec->index;
+  for (size_t i = tag & ix->mask;; i = (i + 1) & ix->mask) {
+    const index_slot_t *s = &ix->slots[i];
+    if (s->pos == 0 ||
+        (s->tag == tag && string_equal(svec->buf[s->pos - 1], str)))
+      return i;
+  }
+}
+
+static void index_drop(string_vector_t *svec) {
+  if (!svec->arena)
+    heap_free(svec->index->slots);
+  svec->index->slots = NULL;
+}
+
+/* Builds the table for all elements, or fails and leaves it unbuilt. */
+static bool index_build(string_vector_t *svec, size_t n, const char *fn) {
+  struct string_vector_index *ix = svec->index;
+  size_t cap = INDEX_CAP_MIN;
+  while (cap / 4 * 3 < n)
+    cap *= 2;
+  if (ix->slots != NULL)
+    index_drop(svec);
+  ix->slots = mem_alloc(svec->arena, cap * sizeof(index_slot_t), fn);
+  if (unlikely(ix->slots == NULL))
+    return false;
+  memset(ix->slots, 0, cap * sizeof(index_slot_t));
+  ix->mask = cap - 1;
+  ix->len = 0;
+  for (int i = 0; i <= svec->top; i++) {
+    uint32_t tag = index_tag(ix, svec->buf[i]);
+    size_t j = index_slot(svec, svec->buf[i], tag);
+    if (ix->slots[j].pos == 0) {
+      ix->slots[j] = (index_slot_t){tag, i + 1};
+      ix->len += 1;
+    }
+  }
+  return true;
+}
+
+/* Adds the last element of a vector to its built index. */
+static void index_add(string_vector_t *svec, const char *fn) {
+  struct string_vector_index *ix = svec->index;
+  if (ix->len + 1 > (ix->mask + 1) / 4 * 3) {
+    /* A failed rebuild leaves the vector to be scanned. */
+    index_build(svec, 2 * (ix->len + 1), fn);
+    return;
+  }
+  string_t *str = svec->buf[svec->top];
+  uint32_t tag = index_tag(ix, str);
+  size_t i = index_slot(svec, str, tag);
+  if (ix->slots[i].pos == 0) {
+    ix->slots[i] = (index_slot_t){tag, svec->top + 1};
+    ix->len += 1;
+  }
+}
+
+/*
+ * Drops element k from the built index of a vector, before the element is
+ * removed. Its slot passes to the next equal element, which only needs to
+ * be searched for if the vector has duplicates at all.
+ */
+static void index_unlink(string_vector_t *svec, int k) {
+  struct string_vector_index *ix = svec->index;
+  index_slot_t *s = ix->slots;
+  uint32_t tag = index_tag(ix, svec->buf[k]);
+  size_t hole = index_slot(svec, svec->buf[k], tag);
+  if (s[hole].pos == (uint32_t)k + 1) {
+    int next = k + 1;
+    if (ix->len == (size_t)svec->top + 1)
+      next = svec->top + 1;
+    while (next <= svec->top && !string_equal(svec->buf[next], svec->buf[k]))
+      next++;
+    if (next <= svec->top) {
+      s[hole].pos = next + 1;
+    } else {
+      for (size_t i = (hole + 1) & ix->mask; s[i].pos; i = (i + 1) & ix->mask)
+        if (((i - (s[i].tag & ix->mask)) & ix->mask) >=
+            ((i - hole) & ix->mask)) {
+          s[hole] = s[i];
+          hole = i;
+        }
+      s[hole].pos = 0;
+      ix->len -= 1;
+    }
+  }
+}
+
+/* Updates the built index of a vector for the removal of element k. */
+static void index_remove(string_vector_t *svec, int k) {
+  index_unlink(svec, k);
+  index_slot_t *s = svec->index->slots;
+  for (size_t i = 0; i <= svec->index->mask; i++)
+    s[i].pos -= s[i].pos > (uint32_t)k + 1;
+}
+
+/* Rebuilds the built index of a vector after its elements have moved. */
+static void index_refresh(string_vector_t *svec, const char *fn) {
+  if (svec->index != NULL && svec->index->slots != NULL)
+    index_build(svec, string_vector_len(svec), fn);
+}
+
+bool string_vector_index(string_vector_t *svec) {
+  if (svec->index == NULL) {
+    svec->index =
+        mem_alloc(svec->arena, sizeof(struct string_vector_index), __func__);
+    if (unlikely(svec->index == NULL))
+      return false;
+    svec->index->slots = NULL;
+    svec->index->seed = (uint64_t)(uintptr_t)svec;
+  }
+  return svec->index->slots != NULL ||
+         index_build(svec, string_vector_len(svec), __func__);
+}
+
+void string_vector_unindex(string_vector_t *svec) {
+  if (svec->index == NULL)
+    return;
+  index_drop(svec);
+  if (!svec->arena)
+    heap_free(svec->index);
+  svec->index = NULL;
+}
+
+size_t string_vector_index_bytes(const string_vector_t *svec) {
+  const struct string_vector_index *ix = svec->index;
+  if (ix == NULL)
+    return 0;
+  return sizeof(*ix) + (ix->slots ? (ix->mask + 1) * sizeof(index_slot_t) : 0);
+}
+
+int string_vector_find(const string_vector_t *svec, const string_t *str) {
+  if (svec->index != NULL && svec->index->slots != NULL) {
+    const index_slot_t *s =
+        &svec->index->slots[index_slot(svec, str, index_tag(svec->index, str))];
+    return (int)s->pos - 1;
+  }
+  for (int i = 0; i <= svec->top; i++)
+    if (string_equal(svec->buf[i], str))
+      return i;
+  return -1;
+}
+
+void string_vector_add(string_vector_t *svec, string_t *str) {
+  if (string_vector_is_full(svec) && unlikely(!string_vector_resize(svec)))
+    return;
+  svec->top += 1;
+  svec->buf[svec->top] = str;
+  if (svec->index != NULL && svec->index->slots != NULL)
+    index_add(svec, __func__);
+}
+
+/**********************************************************************/
+
+string_t *string_vector_remove(string_vector_t *svec, size_t index) {
+  if ((int)index > svec->top)
+    return NULL;
+  if (svec->index != NULL && svec->index->slots != NULL)
+    index_remove(svec, index);
+  string_t *str = svec->buf[index];
+  memmove(svec->buf + index, svec->buf + index + 1,
+          (svec->top - index) * sizeof(string_t *));
+  svec->top -= 1;
+  return str;
+}
+
+/*
+ * The element moved into the gap may now be the first occurrence of its
+ * string, which its index slot has to reflect.
+ */
+string_t *string_vector_swap_remove(string_vector_t *svec, size_t index) {
+  if ((int)index > svec->top)
+    return NULL;
+  bool indexed = svec->index != NULL && svec->index->slots != NULL;
+  if (indexed)
+    index_unlink(svec, index);
+  string_t *str = svec->buf[index];
+  svec->buf[index] = svec->buf[svec->top];
+  svec->top -= 1;
+  if (indexed && (int)index <= svec->top) {
+    string_t *moved = svec->buf[index];
+    index_slot_t *s =
+        &svec->index->slots[index_slot(svec, moved,
+                                       index_tag(svec->index, moved))];
+    if (s->pos > index + 1)
+      s->pos = index + 1;
+  }
+  return str;
+}
+
+/* Frees the strings of a heap vector in [start, end). */
+static void vector_release(string_vector_t *svec, size_t start, size_t end) {
+  if (svec->arena)
+    return;
+  for (size_t i = start; i < end; i++)
+    heap_free(svec->buf[i]);
+}
+
+size_t string_vector_erase(string_vector_t *svec, size_t start, size_t end) {
+  size_t len = string_vector_len(svec);
+  if (end > len)
+    end = len;
+  if (start >= end)
+    return 0;
+  vector_release(svec, start, end);
+  memmove(svec->buf + start, svec->buf + end,
+          (len - end) * sizeof(string_t *));
+  svec->top -= end - start;
+  index_refresh(svec, __func__);
+  return end - start;
+}
+
+size_t string_vector_remove_if(string_vector_t *svec, strboolfunc_t func) {
+  size_t len = string_vector_len(svec), kept = 0;
+  for (size_t i = 0; i < len; i++) {
+    string_t *s = svec->buf[i];
+    if (!func(s))
+      svec->buf[kept++] = s;
+    else if (!svec->arena)
+      heap_free(s);
+  }
+  svec->top = (int)kept - 1;
+  if (kept < len)
+    index_refresh(svec, __func__);
+  return len - kept;
+}
+
+/* Grows the buffer of a vector to hold at least n more strings. */
+static bool vector_reserve(string_vector_t *svec, size_t n, const char *fn) {
+  size_t len = string_vector_len(svec);
+  if (n <= svec->cap - len)
+    return true;
+  if (unlikely(n > (size_t)INT_MAX - len))
+    return false;
+  size_t cap = (2 * svec->cap > len + n) ? 2 * svec->cap : len + n;
+  string_t **buf;
+  if (!svec->arena) {
+    buf = heap_realloc(svec->buf, cap * sizeof(string_t *), fn);
+  } else {
+    buf = string_arena_alloc(svec->arena, cap * sizeof(string_t *));
+    if (likely(buf != NULL))
+      memcpy(buf, svec->buf, len * sizeof(string_t *));
+  }
+  if (unlikely(buf == NULL))
+    return false;
+  svec->buf = buf;
+  svec->cap = cap;
+  return true;
+}
+
+bool string_vector_reserve(string_vector_t *svec, size_t n) {
+  return vector_reserve(svec, n, __func__);
+}
+
+bool string_vector_shrink_to_fit(string_vector_t *svec) {
+  size_t len = string_vector_len(svec);
+  size_t cap = len ? len : 1;
+  if (svec->arena || cap == svec->cap)
+    return true;
+  string_t **buf = heap_realloc(svec->buf, cap * sizeof(string_t *), __func__);
+  if (unlikely(buf == NULL))
+    return false;
+  svec->buf = buf;
+  svec->cap = cap;
+  return true;
+}
+
+bool string_vector_extend(string_vector_t *svec, string_t *const *strs,
+                          size_t n) {
+  if (unlikely(!vector_reserve(svec, n, __func__)))
+    return false;
+  bool indexed = svec->index != NULL && svec->index->slots != NULL;
+  if (!indexed) {
+    memcpy(svec->buf + svec->top + 1, strs, n * sizeof(string_t *));
+    svec->top += n;
+    return true;
+  }
+  for (size_t i = 0; i < n; i++) {
+    svec->buf[++svec->top] = strs[i];
+    if (svec->index->slots != NULL)
+      index_add(svec, __func__);
+  }
+  return true;
+}
+
+/**********************************************************************/
+
+bool string_vector_equal(const string_vector_t *a, const string_vector_t *b) {
+  if (a->top != b->top)
+    return false;
+  for (int i = 0; i <= a->top; i++)
+    if (!string_equal(a->buf[i], b->buf[i]))
+      return false;
+  return true;
+}
+
+/**********************************************************************/
+
+string_vector_t *string_vector_map(strfunc_t func,
+                                   const string_vector_t *svec) {
+  if (string_vector_len(svec) == 0)
+    return vector_alloc(NULL, CAP_DEFAULT, __func__);
+
+  string_vector_t *res = heap_alloc(sizeof(string_vector_t), __func__);
+  if (unlikely(!res))
+    return NULL;
+  res->buf = heap_alloc(svec->cap * sizeof(string_t *), __func__);
+  res->cap = svec->cap;
+  res->top = svec->top;
+  res->arena = NULL;
+  res->index = NULL;
+  memcpy(res->buf, svec->buf, svec->top * sizeof(string_t *));
+
+  for (int i = 0; i <= svec->top; i++)
+    res->buf[i] = func(svec->buf[i]);
+
+  return res;
+}
+
+/**********************************************************************/
+
+string_vector_t *string_vector_filter(strboolfunc_t func,
+                                      const string_vector_t *svec) {
+  string_vector_t *res = vector_alloc(NULL, CAP_DEFAULT, __func__);
+  if (unlikely(!res))
+    return NULL;
+  for (int i = 0; i <= svec->top; i++)
+    if (func(svec->buf[i]))
+      string_vector_add(res, string_dup(NULL, svec->buf[i]->buf,
+                                        svec->buf[i]->len, __func__));
+
+  return res;
+}
+
+/**********************************************************************/
+
+string_t *string_vector_reduce(reducefunc_t func, const string_vector_t *svec,
+                               string_t *initializer) {
+  string_t *val = (initializer)
+                      ? string_dup(NULL, initializer->buf, initializer->len,
+                                   __func__)
+                      : string_dup(NULL, "", 0, __func__);
+
+  for (int i = 0; i <= svec->top; i++) {
+    string_t *t = func(val, svec->buf[i]);
+    heap_free(val);
+    val = t;
+  }
+  return val;
+}
+
+/*************************************************************************
+ *                            Parallel Loops                             *
+ *************************************************************************/
+
+/*
+ * The parallel vector functions cut the indices [0, n) into chunks and
+ * run a loop body over them with a pool of threads that lives for one
+ * call, the calling thread being the last worker. Every worker starts with
+ * an equal range of chunks and takes chunks from its front. A worker whose
+ * range has run dry steals the back half of the range of another worker,
+ * so slow elements do not leave the other threads idle. A range is one
+ * 64-bit word of two chunk numbers, changed only by compare-and-swap: the
+ * front only grows and the back only shrinks, so a stale word never
+ * matches again.
+ */
+
+#define PAR_CHUNK_MIN 256 /* the fewest elements per chunk */
+#define PAR_CHUNKS 16     /* chunks per worker, for stealing */
+
+typedef struct par_pool par_pool_t;
+
+typedef struct {
+  uint64_t range; /* the chunks [range >> 32, (uint32_t)range) */
+  pthread_t tid;
+  bool started;
+  par_pool_t *pool;
+  char pad[32]; /* keeps the ranges of workers on separate cache lines */
+} par_worker_t;
+
+struct par_pool {
+  void (*body)(par_pool_t *pool, size_t begin, size_t end);
+  size_t n, chunk;
+  size_t workers;
+  par_worker_t *w;
+  bool failed;    /* set by a body that failed to allocate memory */
+  const char *fn; /* the public function, which allocations count for */
+
+  const string_vector_t *svec;
+  string_vector_t *res;
+  strfunc_t map;
+  strboolfunc_t filter;
+  reducefunc_t reduce;
+  bool *keep;
+  size_t *counts;
+  const string_t *init;
+  string_t **partial;
+  size_t stride;
+};
+
+/* The number of threads for n elements, or 1 if threads do not pay. */
+static size_t par_threads(size_t threads, size_t n, size_t min) {
+  if (threads == 0) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    threads = (cpus > 0) ? (size_t)cpus : 1;
+  }
+  if (threads > n / min)
+    threads = n / min;
+  return threads ? threads : 1;
+}
+
+static inline uint64_t par_range(uint64_t begin, uint64_t end) {
+  return begin << 32 | end;
+}
+
+/* Takes the first chunk of the range of a worker. */
+static bool par_take(par_worker_t *w, size_t *chunk) {
+  uint64_t r = __atomic_load_n(&w->range, __ATOMIC_ACQUIRE);
+  do {
+    if ((r >> 32) >= (uint32_t)r)
+      return false;
+  } while (!__atomic_compare_exchange_n(&w->range, &r, r + ((uint64_t)1 << 32),
+                                        true, __ATOMIC_ACQ_REL,
+                                        __ATOMIC_ACQUIRE));
+  *chunk = r >> 32;
+  return true;
+}
+
+/* Moves the back half of the range of another worker to an idle one. */
+static bool par_steal(par_pool_t *pool, par_worker_t *self) {
+  size_t me = (size_t)(self - pool->w);
+  for (size_t k = 1; k < pool->workers; k++) {
+    par_worker_t *v = &pool->w[(me + k) % pool->workers];
+    uint64_t r = __atomic_load_n(&v->range, __ATOMIC_ACQUIRE);
+    for (;;) {
+      uint64_t begin = r >> 32, end = (uint32_t)r;
+      if (begin >= end)
+        break;
+      uint64_t mid = end - (end - begin + 1) / 2;
+      if (__atomic_compare_exchange_n(&v->range, &r, par_range(begin, mid),
+                                      true, __ATOMIC_ACQ_REL,
+                                      __ATOMIC_ACQUIRE)) {
+        __atomic_store_n(&self->range, par_range(mid, end), __ATOMIC_RELEASE);
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+static void *par_worker(void *arg) {
+  par_worker_t *self = arg;
+  par_pool_t *pool = self->pool;
+  size_t c;
+  do {
+    while (par_take(self, &c)) {
+      size_t begin = c * pool->chunk, end = begin + pool->chunk;
+      if (end > pool->n)
+        end = pool->n;
+      pool->body(pool, begin, end);
+    }
+  } while (par_steal(pool, self));
+  return NULL;
+}
+
+/*
+ * Runs the body of a pool over [0, n) in chunks of the given size. The
+ * chunks of a worker that could not be started are stolen by the others.
+ */
+static bool par_run(par_pool_t *pool, size_t n, size_t chunk, size_t workers,
+                    const char *fn) {
+  size_t chunks = (n + chunk - 1) / chunk;
+  if (workers > chunks)
+    workers = chunks ? chunks : 1;
+  par_worker_t *w = heap_alloc(workers * sizeof(par_worker_t), fn);
+  if (unlikely(w == NULL))
+    return false;
+  pool->n = n;
+  pool->fn = fn;
+  pool->chunk = chunk;
+  pool->workers = workers;
+  pool->w = w;
+  for (size_t t = 0; t < workers; t++)
+    w[t] = (par_worker_t){.range = par_range(t * chunks / workers,
+                                             (t + 1) * chunks / workers),
+                          .pool = pool};
+  for (size_t t = 0; t + 1 < workers; t++)
+    w[t].started = pthread_create(&w[t].tid, NULL, par_worker, &w[t]) == 0;
+  par_worker(&w[workers - 1]);
+  for (size_t t = 0; t + 1 < workers; t++)
+    if (w[t].started)
+      pthread_join(w[t].tid, NULL);
+  heap_free(w);
+  return !pool->failed;
+}
+
+/* The chunk size that gives every worker PAR_CHUNKS chunks. */
+static size_t par_chunk(size_t n, size_t workers) {
+  size_t chunk = n / (workers * PAR_CHUNKS);
+  return (chunk < PAR_CHUNK_MIN) ? PAR_CHUNK_MIN : chunk;
+}
+
+static void par_fail(par_pool_t *pool) {
+  __atomic_store_n(&pool->failed, true, __ATOMIC_RELAXED);
+}
+
+/**********************************************************************/
+
+static void map_body(par_pool_t *pool, size_t begin, size_t end) {
+  for (size_t i = begin; i < end; i++)
+    pool->res->buf[i] = pool->map(pool->svec->buf[i]);
+}
+
+string_vector_t *string_vector_map_parallel(strfunc_t func,
+                                            const string_vector_t *svec,
+                                            size_t threads) {
+  size_t n = string_vector_len(svec);
+  threads = par_threads(threads, n, PAR_CHUNK_MIN);
+  if (threads <= 1)
+    return string_vector_map(func, svec);
+
+  par_pool_t pool = {.body = map_body, .svec = svec, .map = func};
+  pool.res = vector_alloc(NULL, n, __func__);
+  if (unlikely(pool.res == NULL))
+    return NULL;
+  if (unlikely(!par_run(&pool, n, par_chunk(n, threads), threads,
+                        __func__))) {
+    string_vector_free(pool.res);
+    return NULL;
+  }
+  pool.res->top = svec->top;
+  return pool.res;
+}
+
+/**********************************************************************/
+
+/* Tests the elements of a chunk and counts the ones to keep. */
+static void filter_test(par_pool_t *pool, size_t begin, size_t end) {
+  size_t count = 0;
+  for (size_t i = begin; i < end; i++) {
+    pool->keep[i] = pool->filter(pool->svec->buf[i]);
+    count += pool->keep[i];
+  }
+  pool->counts[begin / pool->chunk] = count;
+}
+
+/* Copies the elements of a chunk to keep, counts now being offsets. */
+static void filter_copy(par_pool_t *pool, size_t begin, size_t end) {
+  size_t k = pool->counts[begin / pool->chunk];
+  for (size_t i = begin; i < end; i++)
+    if (pool->keep[i]) {
+      const string_t *s = pool->svec->buf[i];
+      pool->res->buf[k] = string_dup(NULL, s->buf, s->len, pool->fn);
+      if (unlikely(pool->res->buf[k++] == NULL))
+        par_fail(pool);
+    }
+}
+
+/*
+ * The predicate runs in a first pass that counts the strings each chunk
+ * keeps. The counts give every chunk its offset in the result, and a
+ * second pass copies the strings there, so they keep their order.
+ */
+string_vector_t *string_vector_filter_parallel(strboolfunc_t func,
+                                               const string_vector_t *svec,
+                                               size_t threads) {
+  size_t n = string_vector_len(svec);
+  threads = par_threads(threads, n, PAR_CHUNK_MIN);
+  if (threads <= 1)
+    return string_vector_filter(func, svec);
+
+  size_t chunk = par_chunk(n, threads), chunks = (n + chunk - 1) / chunk;
+  par_pool_t pool = {.body = filter_test, .svec = svec, .filter = func};
+  pool.keep = heap_alloc(n * sizeof(bool), __func__);
+  pool.counts = heap_alloc(chunks * sizeof(size_t), __func__);
+  bool ok = pool.keep != NULL && pool.counts != NULL &&
+            par_run(&pool, n, chunk, threads, __func__);
+
+  size_t total = 0;
+  for (size_t c = 0; ok && c < chunks; c++) {
+    size_t count = pool.counts[c];
+    pool.counts[c] = total;
+    total += count;
+  }
+  if (ok)
+    pool.res = vector_alloc(NULL, total ? total : CAP_DEFAULT, __func__);
+  if (pool.res != NULL) {
+    /* Slots that no copy reaches after a failure must be safe to free. */
+    memset(pool.res->buf, 0, total * sizeof(string_t *));
+    pool.body = filter_copy;
+    ok = par_run(&pool, n, chunk, threads, __func__);
+    pool.res->top = (int)total - 1;
+    if (unlikely(!ok)) {
+      string_vector_deepfree(pool.res);
+      pool.res = NULL;
+    }
+  }
+  heap_free(pool.keep);
+  heap_free(pool.counts);
+  return pool.res;
+}
+
+/**********************************************************************/
+
+/*
+ * Folds the elements of a chunk into a partial value. The first chunk
+ * starts with the initial value, the others with their first element.
+ */
+static void reduce_chunk(par_pool_t *pool, size_t begin, size_t end) {
+  size_t c = begin / pool->chunk;
+  const string_t *first = (c == 0) ? pool->init : pool->svec->buf[begin++];
+  string_t *val = string_dup(NULL, first->buf, first->len, pool->fn);
+  for (size_t i = begin; val != NULL && i < end; i++) {
+    string_t *t = pool->reduce(val, pool->svec->buf[i]);
+    heap_free(val);
+    val = t;
+  }
+  if (unlikely(val == NULL))
+    par_fail(pool);
+  pool->partial[c] = val;
+}
+
+/* Combines pairs of partial values that are `stride` chunks apart. */
+static void reduce_pairs(par_pool_t *pool, size_t begin, size_t end) {
+  for (size_t p = begin; p < end; p++) {
+    string_t **left = &pool->partial[2 * p * pool->stride];
+    string_t *val = pool->reduce(*left, left[pool->stride]);
+    heap_free(*left);
+    heap_free(left[pool->stride]);
+    left[pool->stride] = NULL;
+    *left = val;
+    if (unlikely(val == NULL))
+      par_fail(pool);
+  }
+}
+
+/*
+ * Every chunk is folded into a partial value, and the partial values are
+ * combined in a balanced tree whose levels run in parallel as well. This
+ * calls func on two partial values instead of a value and an element, so
+ * it needs func to be associative.
+ */
+string_t *string_vector_reduce_parallel(reducefunc_t func,
+                                        const string_vector_t *svec,
+                                        string_t *initializer,
+                                        size_t threads) {
+  size_t n = string_vector_len(svec);
+  threads = par_threads(threads, n, PAR_CHUNK_MIN);
+  if (threads <= 1)
+    return string_vector_reduce(func, svec, initializer);
+
+  string_t empty = {0};
+  size_t chunk = par_chunk(n, threads), chunks = (n + chunk - 1) / chunk;
+  par_pool_t pool = {.body = reduce_chunk,
+                     .svec = svec,
+                     .reduce = func,
+                     .init = initializer ? initializer : &empty};
+  pool.partial = heap_alloc(chunks * sizeof(string_t *), __func__);
+  if (unlikely(pool.partial == NULL))
+    return NULL;
+  memset(pool.partial, 0, chunks * sizeof(string_t *));
+  bool ok = par_run(&pool, n, chunk, threads, __func__);
+
+  pool.body = reduce_pairs;
+  for (pool.stride = 1; ok && pool.stride < chunks; pool.stride *= 2) {
+    size_t pairs = (chunks - pool.stride + 2 * pool.stride - 1) /
+                   (2 * pool.stride);
+    ok = par_run(&pool, pairs, 1, threads, __func__);
+  }
+  string_t *val = pool.partial[0];
+  if (unlikely(!ok)) {
+    for (size_t c = 0; c < chunks; c++)
+      heap_free(pool.partial[c]);
+    val = NULL;
+  }
+  heap_free(pool.partial);
+  return val;
+}
+
+/*************************************************************************
+ *                               Sorting                                 *
+ *************************************************************************/
+
+/*
+ * Strings are sorted as items that cache 8 bytes of the string, starting
+ * at the depth to which all strings of a partition are known to agree, as
+ * a big-endian integer padded with zero bytes. Most comparisons are then
+ * integer comparisons on a contiguous array, without touching the strings.
+ *
+ * string_vector_sort() is a multikey quicksort: it partitions the items
+ * three ways by their cached words and only goes 8 bytes deeper for the
+ * items equal to the pivot. Strings that end within the cached word are a
+ * prefix of the others in that partition and precede them, ordered by
+ * length. The stable sort is an MSD radix sort of the items on one byte
+ * at a time, and the parallel sort merges runs that threads have sorted
+ * with the multikey quicksort.
+ */
+
+#define SORT_INSERTION_MAX 16
+#define SORT_NINTHER_MIN 128
+#define SORT_RUN 32
+#define SORT_PARALLEL_MIN 65536
+
+typedef struct {
+  uint64_t key;
+  string_t *str;
+} sort_item_t;
+
+static inline uint64_t sort_key(const string_t *s, size_t depth) {
+  if (depth >= s->len)
+    return 0;
+  uint64_t k = 0;
+  memcpy(&k, s->buf + depth, (s->len - depth < 8) ? s->len - depth : 8);
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  k = __builtin_bswap64(k);
+#endif
+  return k;
+}
+
+/* Compares items whose strings agree on their first depth bytes. */
+static inline int item_compare(const sort_item_t *a, const sort_item_t *b,
+                               size_t depth) {
+  if (a->key != b->key)
+    return (a->key < b->key) ? -1 : 1;
+  size_t m = a->str->len, n = b->str->len, d = depth + 8;
+  if (m <= d || n <= d)
+    return (m > n) - (m < n);
+  return bytes_compare(a->str->buf + d, m - d, b->str->buf + d, n - d);
+}
+
+static inline void item_swap(sort_item_t *a, sort_item_t *b) {
+  sort_item_t t = *a;
+  *a = *b;
+  *b = t;
+}
+
+static void insertion_sort(sort_item_t *a, size_t n, size_t depth) {
+  for (size_t i = 1; i < n; i++) {
+    sort_item_t t = a[i];
+    size_t j = i;
+    for (; j > 0 && item_compare(&t, &a[j - 1], depth) < 0; j--)
+      a[j] = a[j - 1];
+    a[j] = t;
+  }
+}
+
+static inline uint64_t median3(uint64_t x, uint64_t y, uint64_t z) {
+  if (x > y) {
+    uint64_t t = x;
+    x = y;
+    y = t;
+  }
+  return (z < x) ? x : (z > y) ? y : z;
+}
+
+/* The median of 3 keys, or for larger partitions the median of 3 medians. */
+static uint64_t pivot(const sort_item_t *a, size_t n) {
+  if (n < SORT_NINTHER_MIN)
+    return median3(a[0].key, a[n / 2].key, a[n - 1].key);
+  size_t s = n / 8, m = n / 2;
+  return median3(median3(a[0].key, a[s].key, a[2 * s].key),
+                 median3(a[m - s].key, a[m].key, a[m + s].key),
+                 median3(a[n - 1 - 2 * s].key, a[n - 1 - s].key,
+                         a[n - 1].key));
+}
+
+/* Moves the strings of at most depth + 8 bytes to the front, by length. */
+static size_t ended_first(sort_item_t *a, size_t n, size_t depth) {
+  size_t e = 0;
+  for (size_t j = 0; j < n; j++)
+    if (a[j].str->len <= depth + 8)
+      item_swap(&a[e++], &a[j]);
+  for (size_t len = depth, k = 0; len < depth + 8 && k < e; len++)
+    for (size_t j = k; j < e; j++)
+      if (a[j].str->len == len)
+        item_swap(&a[k++], &a[j]);
+  return e;
+}
+
+/*
+ * Prepares the items that agree on the cached word at depth for sorting 8
+ * bytes deeper: moves the ended strings to the front and reloads the words
+ * of the others. Returns the number of the others, which follow the ended
+ * ones in *a.
+ */
+static size_t descend(sort_item_t **a, size_t n, size_t depth) {
+  size_t e = ended_first(*a, n, depth);
+  *a += e;
+  n -= e;
+  for (size_t j = 0; j < n; j++)
+    (*a)[j].key = sort_key((*a)[j].str, depth + 8);
+  return n;
+}
+
+/*
+ * Recurses into the two smaller of the three partitions and loops on the
+ * largest, so that the recursion stays O(log n) deep even when the pivots
+ * are poor.
+ */
+static void multikey_sort(sort_item_t *a, size_t n, size_t depth) {
+  while (n > SORT_INSERTION_MAX) {
+    uint64_t p = pivot(a, n);
+    size_t lt = 0, i = 0, gt = n;
+    while (i < gt) {
+      if (a[i].key < p)
+        item_swap(&a[lt++], &a[i++]);
+      else if (a[i].key > p)
+        item_swap(&a[i], &a[--gt]);
+      else
+        i++;
+    }
+
+    size_t eq = gt - lt, hi = n - gt;
+    sort_item_t *e = a + lt;
+    if (eq >= lt && eq >= hi) {
+      multikey_sort(a, lt, depth);
+      multikey_sort(a + gt, hi, depth);
+      n = descend(&e, eq, depth);
+      a = e;
+      depth += 8;
+      continue;
+    }
+    size_t m = descend(&e, eq, depth);
+    multikey_sort(e, m, depth + 8);
+    if (lt < hi) {
+      multikey_sort(a, lt, depth);
+      a += gt;
+      n = hi;
+    } else {
+      multikey_sort(a + gt, hi, depth);
+      n = lt;
+    }
+  }
+  insertion_sort(a, n, depth);
+}
+
+/* Merges the sorted runs a[0, m) and a[m, n) into out. */
+static void merge_runs(const sort_item_t *a, size_t m, size_t n,
+                       sort_item_t *out) {
+  size_t i = 0, j = m, k = 0;
+  while (i < m && j < n)
+    out[k++] = (item_compare(&a[j], &a[i], 0) < 0) ? a[j++] : a[i++];
+  memcpy(out + k, a + i, (m - i) * sizeof(sort_item_t));
+  k += m - i;
+  memcpy(out + k, a + j, (n - j) * sizeof(sort_item_t));
+}
+
+/*
+ * A stable MSD radix sort on byte b of the cached words, with tmp as
+ * scratch space of the same size. Every pass scatters the items into
+ * buckets by one byte, skipping bytes on which they all agree, and
+ * continues with the largest bucket in place so that the recursion into
+ * the others stays shallow. Once all 8 bytes agree, the strings that
+ * ended are moved to the front by length and the words are reloaded 8
+ * bytes deeper.
+ */
+static void radix_sort(sort_item_t *a, sort_item_t *tmp, size_t n,
+                       size_t depth, int b) {
+  while (n > SORT_RUN) {
+    size_t count[256] = {0}, start[256], big = 0;
+    if (b == 8) {
+      for (size_t i = 0; i < n; i++) {
+        size_t len = a[i].str->len - depth;
+        count[(len <= 8) ? len : 9]++;
+      }
+      for (size_t d = 0, sum = 0; d < 10; sum += count[d++])
+        start[d] = sum;
+      for (size_t i = 0; i < n; i++) {
+        size_t len = a[i].str->len - depth;
+        tmp[start[(len <= 8) ? len : 9]++] = a[i];
+      }
+      memcpy(a, tmp, n * sizeof(sort_item_t));
+      a += n - count[9];
+      tmp += n - count[9];
+      n = count[9];
+      depth += 8;
+      b = 0;
+      for (size_t i = 0; i < n; i++)
+        a[i].key = sort_key(a[i].str, depth);
+      continue;
+    }
+
+    int shift = 56 - 8 * b;
+    for (size_t i = 0; i < n; i++)
+      count[(a[i].key >> shift) & 0xff]++;
+    b++;
+    if (count[(a[0].key >> shift) & 0xff] == n)
+      continue;
+    for (size_t d = 0, sum = 0; d < 256; sum += count[d++]) {
+      start[d] = sum;
+      if (count[d] > count[big])
+        big = d;
+    }
+    for (size_t i = 0; i < n; i++)
+      tmp[start[(a[i].key >> shift) & 0xff]++] = a[i];
+    memcpy(a, tmp, n * sizeof(sort_item_t));
+    for (size_t d = 0; d < 256; d++)
+      if (d != big && count[d] > 1)
+        radix_sort(a + start[d] - count[d], tmp + start[d] - count[d],
+                   count[d], depth, b);
+    a += start[big] - count[big];
+    tmp += start[big] - count[big];
+    n = count[big];
+  }
+  insertion_sort(a, n, depth);
+}
+
+static sort_item_t *sort_items(const string_vector_t *svec, size_t extra,
+                               const char *fn) {
+  size_t n = string_vector_len(svec);
+  if (unlikely(n > SIZE_MAX / sizeof(sort_item_t) / (1 + extra)))
+    return NULL;
+  sort_item_t *items = heap_alloc((n ? n : 1) * (1 + extra) *
+                                      sizeof(sort_item_t), fn);
+  if (unlikely(items == NULL))
+    return NULL;
+  for (size_t i = 0; i < n; i++)
+    items[i] = (sort_item_t){sort_key(svec->buf[i], 0), svec->buf[i]};
+  return items;
+}
+
+static void sort_finish(string_vector_t *svec, const sort_item_t *items,
+                        const char *fn) {
+  for (size_t i = 0; i < string_vector_len(svec); i++)
+    svec->buf[i] = items[i].str;
+  index_refresh(svec, fn);
+}
+
+bool string_vector_sort(string_vector_t *svec) {
+  sort_item_t *items = sort_items(svec, 0, __func__);
+  if (unlikely(items == NULL))
+    return false;
+  multikey_sort(items, string_vector_len(svec), 0);
+  sort_finish(svec, items, __func__);
+  heap_free(items);
+  return true;
+}
+
+bool string_vector_sort_stable(string_vector_t *svec) {
+  size_t n = string_vector_len(svec);
+  sort_item_t *items = sort_items(svec, 1, __func__);
+  if (unlikely(items == NULL))
+    return false;
+  radix_sort(items, items + n, n, 0, 0);
+  sort_finish(svec, items, __func__);
+  heap_free(items);
+  return true;
+}
+
+/*
+ * A job either sorts the items a[0, n) and resets their keys to the first
+ * 8 bytes for merging, or merges the runs a[0, m) and a[m, n) into out.
+ */
+typedef struct {
+  sort_item_t *a;
+  size_t m, n;
+  sort_item_t *out; /* NULL for a sorting job */
+  pthread_t tid;
+  bool started;
+} sort_job_t;
+
+static void *sort_job(void *arg) {
+  sort_job_t *job = arg;
+  if (job->out != NULL) {
+    merge_runs(job->a, job->m, job->n, job->out);
+    return NULL;
+  }
+  multikey_sort(job->a, job->n, 0);
+  for (size_t i = 0; i < job->n; i++)
+    job->a[i].key = sort_key(job->a[i].str, 0);
+  return NULL;
+}
+
+/* Runs the last job in the calling thread and the others in new ones. */
+static void sort_jobs(sort_job_t *jobs, size_t count) {
+  for (size_t t = 0; t + 1 < count; t++) {
+    jobs[t].started =
+        pthread_create(&jobs[t].tid, NULL, sort_job, &jobs[t]) == 0;
+    if (unlikely(!jobs[t].started))
+      sort_job(&jobs[t]);
+  }
+  sort_job(&jobs[count - 1]);
+  for (size_t t = 0; t + 1 < count; t++)
+    if (jobs[t].started)
+      pthread_join(jobs[t].tid, NULL);
+}
+
+/*
+ * Each thread sorts an equal share of the items. The sorted runs are then
+ * merged pairwise, with the merges of each round running in parallel.
+ */
+bool string_vector_sort_parallel(string_vector_t *svec, size_t threads) {
+  size_t n = string_vector_len(svec);
+  threads = par_threads(threads, n, SORT_PARALLEL_MIN);
+  if (threads <= 1)
+    return string_vector_sort(svec);
+
+  sort_item_t *items = sort_items(svec, 1, __func__);
+  sort_job_t *jobs = heap_alloc(threads * sizeof(sort_job_t), __func__);
+  if (unlikely(items == NULL || jobs == NULL)) {
+    heap_free(items);
+    heap_free(jobs);
+    return false;
+  }
+
+  size_t run = (n + threads - 1) / threads, count = 0;
+  for (size_t i = 0; i < n; i += run)
+    jobs[count++] = (sort_job_t){.a = items + i,
+                                 .n = (n - i < run) ? n - i : run};
+  sort_jobs(jobs, count);
+
+  sort_item_t *a = items, *tmp = items + n;
+  for (; run < n; run *= 2) {
+    count = 0;
+    for (size_t i = 0; i < n; i += 2 * run) {
+      size_t m = (n - i < run) ? n - i : run;
+      size_t end = (n - i < 2 * run) ? n - i : 2 * run;
+      jobs[count++] =
+          (sort_job_t){.a = a + i, .m = m, .n = end, .out = tmp + i};
+    }
+    sort_jobs(jobs, count);
+    sort_item_t *t = a;
+    a = tmp;
+    tmp = t;
+  }
+
+  sort_finish(svec, a, __func__);
+  heap_free(items);
+  heap_free(jobs);
+  return true;
+}
+
+/*************************************************************************
+ *                            Set Operations                             *
+ *************************************************************************/
+
+/*
+ * The set operations treat vectors as sets of distinct strings. If both
+ * inputs are sorted, they are merged in one pass that skips repeated
+ * strings, and the result is sorted as well. Otherwise the distinct
+ * strings of both inputs are put into hash tables built like the index of
+ * a vector, and the result lists the strings of a before those of b, each
+ * in the order of its first occurrence.
+ */
+
+enum { SET_UNION, SET_INTERSECT, SET_DIFFERENCE };
+
+/* A hash table of the distinct strings of a vector, for a short while. */
+typedef struct {
+  string_vector_t vec; /* a shallow copy of the vector, using ix */
+  struct string_vector_index ix;
+} string_set_t;
+
+static bool set_build(string_set_t *set, const string_vector_t *svec,
+                      const char *fn) {
+  set->vec = *svec;
+  set->vec.arena = NULL;
+  set->vec.index = &set->ix;
+  set->ix.slots = NULL;
+  set->ix.seed = (uint64_t)(uintptr_t)set;
+  return index_build(&set->vec, string_vector_len(svec), fn);
+}
+
+/* The index of the first occurrence of a string in a set, or -1. */
+static inline int set_find(const string_set_t *set, const string_t *str) {
+  size_t i = index_slot(&set->vec, str, index_tag(&set->ix, str));
+  return (int)set->ix.slots[i].pos - 1;
+}
+
+static bool vector_sorted(const string_vector_t *svec) {
+  for (int i = 1; i <= svec->top; i++)
+    if (string_compare(svec->buf[i - 1], svec->buf[i]) > 0)
+      return false;
+  return true;
+}
+
+static inline bool repeated(const string_vector_t *svec, size_t i) {
+  return i > 0 && string_equal(svec->buf[i], svec->buf[i - 1]);
+}
+
+/*
+ * Collects the strings of `a op b` in out, which has room for the strings
+ * of both vectors, without copying them. from_b[k] tells whether out[k]
+ * belongs to b. Returns the number of strings, or NPOS if memory
+ * allocation failed.
+ */
+static size_t set_collect(const string_vector_t *a, const string_vector_t *b,
+                          int op, string_t **out, bool *from_b,
+                          const char *fn) {
+  size_t m = string_vector_len(a), n = string_vector_len(b), k = 0;
+  if (vector_sorted(a) && vector_sorted(b)) {
+    size_t i = 0, j = 0;
+    while (i < m || (j < n && op == SET_UNION)) {
+      if (i < m && repeated(a, i)) {
+        i++;
+        continue;
+      }
+      if (j < n && repeated(b, j)) {
+        j++;
+        continue;
+      }
+      int c = (i == m)   ? 1
+              : (j == n) ? -1
+                         : string_compare(a->buf[i], b->buf[j]);
+      if (op == SET_UNION || (op == SET_INTERSECT ? c == 0 : c < 0)) {
+        from_b[k] = c > 0;
+        out[k++] = (c <= 0) ? a->buf[i] : b->buf[j];
+      }
+      i += c <= 0;
+      j += c >= 0;
+    }
+    return k;
+  }
+
+  string_set_t sa, sb;
+  bool ok = set_build(&sa, a, fn);
+  ok = set_build(&sb, b, fn) && ok;
+  if (likely(ok)) {
+    for (size_t i = 0; i < m; i++)
+      if (set_find(&sa, a->buf[i]) == (int)i &&
+          (op == SET_UNION ||
+           (op == SET_INTERSECT) == (set_find(&sb, a->buf[i]) >= 0))) {
+        from_b[k] = false;
+        out[k++] = a->buf[i];
+      }
+    for (size_t j = 0; op == SET_UNION && j < n; j++)
+      if (set_find(&sb, b->buf[j]) == (int)j && set_find(&sa, b->buf[j]) < 0) {
+        from_b[k] = true;
+        out[k++] = b->buf[j];
+      }
+  }
+  heap_free(sa.ix.slots);
+  heap_free(sb.ix.slots);
+  return ok ? k : NPOS;
+}
+
+static string_t **set_alloc(const string_vector_t *a,
+                            const string_vector_t *b, bool **from_b,
+                            const char *fn) {
+  size_t n = string_vector_len(a) + string_vector_len(b) + 1;
+  string_t **out = heap_alloc(n * (sizeof(string_t *) + sizeof(bool)), fn);
+  if (likely(out != NULL))
+    *from_b = (bool *)(out + n);
+  return out;
+}
+
+static string_vector_t *set_copy(const string_vector_t *a,
+                                 const string_vector_t *b, int op,
+                                 const char *fn) {
+  bool *from_b;
+  string_t **out = set_alloc(a, b, &from_b, fn);
+  if (unlikely(out == NULL))
+    return NULL;
+  size_t k = set_collect(a, b, op, out, from_b, fn);
+  string_vector_t *res =
+      (k == NPOS) ? NULL : vector_alloc(NULL, k ? k : CAP_DEFAULT, fn);
+  for (size_t i = 0; res != NULL && i < k; i++) {
+    string_t *s = string_dup(NULL, out[i]->buf, out[i]->len, fn);
+    if (unlikely(s == NULL)) {
+      string_vector_deepfree(res);
+      res = NULL;
+      break;
+    }
+    res->buf[++res->top] = s;
+  }
+  heap_free(out);
+  return res;
+}
+
+/*
+ * Replaces the strings of a by those of `a op b`, copying the ones that
+ * come from b and freeing the ones of a that are dropped. The strings of
+ * a in the result keep their relative order, so they can be matched up
+ * with a in one pass.
+ */
+static bool set_inplace(string_vector_t *a, const string_vector_t *b,
+                        int op, const char *fn) {
+  size_t m = string_vector_len(a);
+  bool *from_b;
+  string_t **out = set_alloc(a, b, &from_b, fn);
+  if (unlikely(out == NULL))
+    return false;
+  size_t k = set_collect(a, b, op, out, from_b, fn);
+  if (unlikely(k == NPOS || (k > m && !vector_reserve(a, k - m, fn)))) {
+    heap_free(out);
+    return false;
+  }
+  for (size_t t = 0; t < k; t++)
+    if (from_b[t]) {
+      string_t *s = string_dup(a->arena, out[t]->buf, out[t]->len, fn);
+      if (unlikely(s == NULL)) {
+        while (!a->arena && t--)
+          if (from_b[t])
+            heap_free(out[t]);
+        heap_free(out);
+        return false;
+      }
+      out[t] = s;
+    }
+
+  for (size_t i = 0, t = 0; i < m; i++) {
+    while (t < k && from_b[t])
+      t++;
+    if (t < k && out[t] == a->buf[i])
+      t++;
+    else if (!a->arena)
+      heap_free(a->buf[i]);
+  }
+  memcpy(a->buf, out, k * sizeof(string_t *));
+  a->top = (int)k - 1;
+  index_refresh(a, fn);
+  heap_free(out);
+  return true;
+}
+
+bool string_vector_unique(string_vector_t *svec) {
+  string_vector_t empty = {0, -1, NULL, NULL, NULL};
+  return set_inplace(svec, &empty, SET_UNION, __func__);
+}
+
+string_vector_t *string_vector_union(const string_vector_t *a,
+                                     const string_vector_t *b) {
+  return set_copy(a, b, SET_UNION, __func__);
+}
+
+string_vector_t *string_vector_intersect(const string_vector_t *a,
+                                         const string_vector_t *b) {
+  return set_copy(a, b, SET_INTERSECT, __func__);
+}
+
+string_vector_t *string_vector_difference(const string_vector_t *a,
+                                          const string_vector_t *b) {
+  return set_copy(a, b, SET_DIFFERENCE, __func__);
+}
+
+bool string_vector_union_inplace(string_vector_t *a,
+                                 const string_vector_t *b) {
+  return set_inplace(a, b, SET_UNION, __func__);
+}
+
+bool string_vector_intersect_inplace(string_vector_t *a,
+                                     const string_vector_t *b) {
+  return set_inplace(a, b, SET_INTERSECT, __func__);
+}
+
+bool string_vector_difference_inplace(string_vector_t *a,
+                                      const string_vector_t *b) {
+  return set_inplace(a, b, SET_DIFFERENCE, __func__);
+}
+
+/*************************************************************************
+ *                            String View                                *
+ *************************************************************************/
+
+string_view_t string_view_substring(string_view_t v, size_t start,
+                                    size_t end) {
+  if (unlikely(start > end || end > v.len))
+    return (string_view_t){0, NULL};
+  return (string_view_t){end - start, v.buf + start};
+}
+
+string_view_t string_view_trim(string_view_t v) {
+  size_t l, r;
+  trim_bounds(v.buf, v.len, &l, &r);
+  return (string_view_t){r - l, v.buf + l};
+}
+
+string_t *string_view_tostring(string_view_t v) {
+  return string_dup(NULL, v.buf, v.len, __func__);
+}
+
+int string_view_compare(string_view_t a, string_view_t b) {
+  return bytes_compare(a.buf, a.len, b.buf, b.len);
+}
+
+bool string_view_equal(string_view_t a, string_view_t b) {
+  return a.len == b.len && bytes_equal(a.buf, b.buf, a.len);
+}
+
+uint64_t string_view_hash(string_view_t v, uint64_t seed) {
+  return hash_bytes(v.buf, v.len, seed);
+}
+
+int string_view_index(string_view_t str, string_view_t sub) {
+  size_t r = search(str.buf, str.len, sub.buf, sub.len, 0);
+  return (r == NPOS) ? -1 : (int)r;
+}
+
+/**********************************************************************/
+
+static string_view_vector_t *view_vector_alloc(size_t cap, const char *fn) {
+  string_view_vector_t *vvec = heap_alloc(sizeof(string_view_vector_t), fn);
+  if (unlikely(vvec == NULL))
+    return NULL;
+  vvec->buf = heap_alloc(cap * sizeof(string_view_t), fn);
+  if (unlikely(vvec->buf == NULL)) {
+    heap_free(vvec);
+    return NULL;
+  }
+  vvec->cap = cap;
+  vvec->top = -1;
+  return vvec;
+}
+
+string_view_vector_t *string_view_vector_empty() {
+  return view_vector_alloc(CAP_DEFAULT, __func__);
+}
+
+void string_view_vector_free(string_view_vector_t *vvec) {
+  heap_free(vvec->buf);
+  heap_free(vvec);
+}
+
+bool string_view_vector_add(string_view_vector_t *vvec, string_view_t v) {
+  if ((size_t)(vvec->top + 1) == vvec->cap &&
+      unlikely(!array_grow((void **)&vvec->buf, &vvec->cap,
+                           sizeof(string_view_t), __func__)))
+    return false;
+  vvec->top += 1;
+  vvec->buf[vvec->top] = v;
+  return true;
+}
+
+string_view_vector_t *string_view_split(string_view_t v, char delimiter) {
+  size_t n = count_byte(v.buf, v.len, delimiter) + 1;
+  string_view_vector_t *vvec = view_vector_alloc(n, __func__);
+  if (unlikely(vvec == NULL))
+    return NULL;
+
+  string_split_iter_t it = string_split_iter(v, delimiter);
+  string_view_t field;
+  while (string_split_next(&it, &field))
+    vvec->buf[++vvec->top] = field;
+  return vvec;
+}
+
+string_view_vector_t *string_view_ssplit(string_view_t v,
+                                         string_view_t delimiter) {
+  string_view_vector_t *vvec = view_vector_alloc(CAP_DEFAULT, __func__);
+  if (unlikely(vvec == NULL))
+    return NULL;
+
+  finder_t f;
+  finder_init(&f, (const unsigned char *)delimiter.buf, delimiter.len);
+  size_t start = 0, splits = STRING_SPLIT_ALL;
+  while (start != NPOS)
+    if (unlikely(!string_view_vector_add(
+            vvec, ssplit_field(&f, v.buf, v.len, &start, &splits)))) {
+      string_view_vector_free(vvec);
+      return NULL;
+    }
+  return vvec;
+}
+
+/*************************************************************************
+ *                          Flat String Vector                           *
+ *************************************************************************/
+
+/*
+ * A flat vector is allocated together with room for the offsets of its
+ * initial capacity, so that string_split_flat() needs one allocation for
+ * the vector and one for the bytes. The offsets move to an allocation of
+ * their own when they outgrow that room.
+ */
+
+#define FLATVEC_BYTES_DEFAULT 64
+
+static inline bool flatvec_offsets_inline(const string_flatvec_t *fvec) {
+  return fvec->offsets == (size_t *)(fvec + 1);
+}
+
+static string_flatvec_t *flatvec_alloc(size_t cap, size_t bytes_cap,
+                                       const char *fn) {
+  if (unlikely(cap > (SIZE_MAX - sizeof(string_flatvec_t)) / sizeof(size_t) -
+                         1))
+    return NULL;
+  string_flatvec_t *fvec =
+      heap_alloc(sizeof(string_flatvec_t) + (cap + 1) * sizeof(size_t), fn);
+  if (unlikely(fvec == NULL))
+    return NULL;
+  fvec->bytes_cap = bytes_cap ? bytes_cap : 1;
+  fvec->bytes = heap_alloc(fvec->bytes_cap, fn);
+  if (unlikely(fvec->bytes == NULL)) {
+    heap_free(fvec);
+    return NULL;
+  }
+  fvec->len = 0;
+  fvec->cap = cap;
+  fvec->offsets = (size_t *)(fvec + 1);
+  fvec->offsets[0] = 0;
+  return fvec;
+}
+
+/* Makes room for one more string of n bytes. */
+static bool flatvec_grow(string_flatvec_t *fvec, size_t n, const char *fn) {
+  size_t used = fvec->offsets[fvec->len];
+  if (unlikely(n > SIZE_MAX / 2 - used))
+    return false;
+  while (fvec->bytes_cap - used < n)
+    if (unlikely(!array_grow((void **)&fvec->bytes, &fvec->bytes_cap, 1, fn)))
+      return false;
+  if (likely(fvec->len < fvec->cap))
+    return true;
+
+  size_t cap = 2 * fvec->cap + 1, size = (cap + 1) * sizeof(size_t);
+  size_t *offsets;
+  if (flatvec_offsets_inline(fvec)) {
+    offsets = heap_alloc(size, fn);
+    if (likely(offsets != NULL))
+      memcpy(offsets, fvec->offsets, (fvec->len + 1) * sizeof(size_t));
+  } else {
+    offsets = heap_realloc(fvec->offsets, size, fn);
+  }
+  if (unlikely(offsets == NULL))
+    return false;
+  fvec->offsets = offsets;
+  fvec->cap = cap;
+  return true;
+}
+
+static inline void flatvec_push(string_flatvec_t *fvec, const char *buf,
+                                size_t n) {
+  size_t end = fvec->offsets[fvec->len];
+  memcpy(fvec->bytes + end, buf, n);
+  fvec->offsets[++fvec->len] = end + n;
+}
+
+string_flatvec_t *string_flatvec_empty() {
+  return flatvec_alloc(CAP_DEFAULT, FLATVEC_BYTES_DEFAULT, __func__);
+}
+
+void string_flatvec_free(string_flatvec_t *fvec) {
+  if (!flatvec_offsets_inline(fvec))
+    heap_free(fvec->offsets);
+  heap_free(fvec->bytes);
+  heap_free(fvec);
+}
+
+bool string_flatvec_add_view(string_flatvec_t *fvec, string_view_t v) {
+  if (unlikely(!flatvec_grow(fvec, v.len, __func__)))
+    return false;
+  flatvec_push(fvec, v.buf, v.len);
+  return true;
+}
+
+bool string_flatvec_add(string_flatvec_t *fvec, const string_t *str) {
+  if (unlikely(!flatvec_grow(fvec, str->len, __func__)))
+    return false;
+  flatvec_push(fvec, str->buf, str->len);
+  return true;
+}
+
+int string_flatvec_find(const string_flatvec_t *fvec, const string_t *str) {
+  for (size_t i = 0; i < fvec->len; i++)
+    if (fvec->offsets[i + 1] - fvec->offsets[i] == str->len &&
+        bytes_equal(fvec->bytes + fvec->offsets[i], str->buf, str->len))
+      return (int)i;
+  return -1;
+}
+
+static int view_cmp(const void *a, const void *b) {
+  const string_view_t *x = a, *y = b;
+  return bytes_compare(x->buf, x->len, y->buf, y->len);
+}
+
+/* Sorts views of the strings, then copies them into a new buffer. */
+bool string_flatvec_sort(string_flatvec_t *fvec) {
+  string_view_t *views = heap_alloc(
+      (fvec->len ? fvec->len : 1) * sizeof(string_view_t), __func__);
+  char *bytes = heap_alloc(fvec->bytes_cap, __func__);
+  if (unlikely(views == NULL || bytes == NULL)) {
+    heap_free(views);
+    heap_free(bytes);
+    return false;
+  }
+  for (size_t i = 0; i < fvec->len; i++)
+    views[i] = string_flatvec_get(fvec, i);
+  qsort(views, fvec->len, sizeof(string_view_t), view_cmp);
+  for (size_t i = 0; i < fvec->len; i++) {
+    memcpy(bytes + fvec->offsets[i], views[i].buf, views[i].len);
+    fvec->offsets[i + 1] = fvec->offsets[i] + views[i].len;
+  }
+  heap_free(views);
+  heap_free(fvec->bytes);
+  fvec->bytes = bytes;
+  return true;
+}
+
+string_vector_t *string_flatvec_tovector(const string_flatvec_t *fvec) {
+  string_vector_t *svec =
+      vector_alloc(NULL, fvec->len ? fvec->len : CAP_DEFAULT, __func__);
+  if (unlikely(svec == NULL))
+    return NULL;
+  for (size_t i = 0; i < fvec->len; i++) {
+    string_view_t v = string_flatvec_get(fvec, i);
+    string_t *s = string_dup(NULL, v.buf, v.len, __func__);
+    if (unlikely(s == NULL)) {
+      string_vector_deepfree(svec);
+      return NULL;
+    }
+    svec->buf[++svec->top] = s;
+  }
+  return svec;
+}
+
+string_flatvec_t *string_flatvec_from_vector(const string_vector_t *svec) {
+  size_t n = string_vector_len(svec), bytes = 0;
+  for (size_t i = 0; i < n; i++)
+    bytes += svec->buf[i]->len;
+  string_flatvec_t *fvec = flatvec_alloc(n, bytes, __func__);
+  if (unlikely(fvec == NULL))
+    return NULL;
+  for (size_t i = 0; i < n; i++)
+    flatvec_push(fvec, svec->buf[i]->buf, svec->buf[i]->len);
+  return fvec;
+}
+
+/* The fields take the bytes of the string except for the delimiters. */
+string_flatvec_t *string_split_flat(const string_t *str, char delimiter) {
+  size_t n = count_byte(str->buf, str->len, delimiter) + 1;
+  string_flatvec_t *fvec = flatvec_alloc(n, str->len - (n - 1), __func__);
+  if (unlikely(fvec == NULL))
+    return NULL;
+  string_split_iter_t it = string_split_iter(string_view(str), delimiter);
+  string_view_t v;
+  while (string_split_next(&it, &v))
+    flatvec_push(fvec, v.buf, v.len);
+  return fvec;
+}
+
+/*************************************************************************
+ *                              String Map                               *
+ *************************************************************************/
+
+/*
+ * An open-addressing hash table in the style of Swiss tables. Every slot
+ * has a control byte, which is CTRL_EMPTY, CTRL_DELETED, or the low 7 bits
+ * of the hash of the slot's key. The slots form groups of 16 whose control
+ * bytes are matched with one SSE2 comparison. Probing visits the groups
+ * quadratically from the one selected by the high bits of the hash and
+ * stops at the first group with an empty slot.
+ *
+ * Full hashes are stored with the keys, so that growing does not rehash
+ * the keys and most mismatches cost one integer comparison. The keys are
+ * copied into an arena owned by the map. An erased key stays there until
+ * the copies of erased keys outweigh those of live ones; the next resize
+ * then copies the live keys into a fresh arena and releases the old one.
+ */
+
+#define MAP_GROUP 16
+#define MAP_CAP_MIN 16
+#define CTRL_EMPTY 0x80
+#define CTRL_DELETED 0xfe
+#define MAP_DEAD_MIN 65536
+
+typedef struct {
+  uint64_t hash;
+  string_t *key;
+  void *value;
+} map_slot_t;
+
+struct string_map {
+  uint8_t *ctrl;      /* one control byte per slot */
+  map_slot_t *slots;  /* cap slots, valid where the control byte is full */
+  size_t cap;         /* a power of 2, at least MAP_CAP_MIN */
+  size_t len;         /* number of keys */
+  size_t growth_left; /* number of empty slots that may still be filled */
+  uint64_t seed;
+  string_arena_t keys;
+  size_t key_bytes;  /* bytes of the key copies in the arena */
+  size_t dead_bytes; /* bytes of the copies of erased keys */
+};
+
+/* The slots of a group whose control byte is c, as a bit mask. */
+static inline uint32_t group_match(const uint8_t *g, uint8_t c) {
+#if defined(__SSE2__)
+  if (likely(isa() >= LIBSTRING_ISA_SSE2)) {
+    __m128i x = _mm_loadu_si128((const __m128i *)g);
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(x, _mm_set1_epi8(c)));
+  }
+#endif
+  uint32_t m = 0;
+  for (int i = 0; i < MAP_GROUP; i++)
+    m |= (uint32_t)(g[i] == c) << i;
+  return m;
+}
+
+/* The empty and deleted slots of a group, which have the top bit set. */
+static inline uint32_t group_free(const uint8_t *g) {
+#if defined(__SSE2__)
+  if (likely(isa() >= LIBSTRING_ISA_SSE2))
+    return _mm_movemask_epi8(_mm_loadu_si128((const __m128i *)g));
+#endif
+  uint32_t m = 0;
+  for (int i = 0; i < MAP_GROUP; i++)
+    m |= (uint32_t)(g[i] >> 7) << i;
+  return m;
+}
+
+static size_t map_lookup(const string_map_t *map, const char *buf, size_t len,
+                         uint64_t hash) {
+  size_t mask = map->cap / MAP_GROUP - 1, g = (hash >> 7) & mask;
+  for (size_t step = 1;; step++) {
+    const uint8_t *ctrl = map->ctrl + g * MAP_GROUP;
+    for (uint32_t m = group_match(ctrl, hash & 0x7f); m; m &= m - 1) {
+      const map_slot_t *s = &map->slots[g * MAP_GROUP + __builtin_ctz(m)];
+      if (s->hash == hash && s->key->len == len &&
+          bytes_equal(s->key->buf, buf, len))
+        return s - map->slots;
+    }
+    if (likely(group_match(ctrl, CTRL_EMPTY)))
+      return NPOS;
+    g = (g + step) & mask;
+  }
+}
+
+/* The first empty or deleted slot on the probe sequence of a hash. */
+static size_t map_free_slot(const uint8_t *ctrl, size_t cap, uint64_t hash) {
+  size_t mask = cap / MAP_GROUP - 1, g = (hash >> 7) & mask;
+  for (size_t step = 1;; step++) {
+    uint32_t m = group_free(ctrl + g * MAP_GROUP);
+    if (likely(m))
+      return g * MAP_GROUP + __builtin_ctz(m);
+    g = (g + step) & mask;
+  }
+}
+
+static inline size_t map_key_bytes(size_t len) {
+  return sizeof(string_t) + len;
+}
+
+/*
+ * Allocates empty tables with `cap` slots and moves the keys there. If
+ * the copies of erased keys outweigh those of live keys, the live keys
+ * are copied into a fresh arena, which replaces the old one.
+ */
+static bool map_resize(string_map_t *map, size_t cap, const char *fn) {
+  if (unlikely(cap > SIZE_MAX / sizeof(map_slot_t)))
+    return false;
+  bool compact = map->dead_bytes > map->key_bytes - map->dead_bytes;
+  string_arena_t keys = map->keys;
+  if (compact)
+    arena_init(&keys, 0);
+  uint8_t *ctrl = heap_alloc(cap, fn);
+  map_slot_t *slots = heap_alloc(cap * sizeof(map_slot_t), fn);
+  if (unlikely(ctrl == NULL || slots == NULL))
+    goto fail;
+  memset(ctrl, CTRL_EMPTY, cap);
+  for (size_t i = 0; i < map->cap; i++)
+    if (!(map->ctrl[i] & 0x80)) {
+      size_t j = map_free_slot(ctrl, cap, map->slots[i].hash);
+      ctrl[j] = map->ctrl[i];
+      slots[j] = map->slots[i];
+      if (compact) {
+        const string_t *k = map->slots[i].key;
+        slots[j].key = string_dup(&keys, k->buf, k->len, fn);
+        if (unlikely(slots[j].key == NULL))
+          goto fail;
+      }
+    }
+  if (compact) {
+    arena_release(&map->keys);
+    map->keys = keys;
+    map->key_bytes -= map->dead_bytes;
+    map->dead_bytes = 0;
+  }
+  heap_free(map->ctrl);
+  heap_free(map->slots);
+  map->ctrl = ctrl;
+  map->slots = slots;
+  map->cap = cap;
+  map->growth_left = cap - cap / 8 - map->len;
+  return true;
+
+fail:
+  if (compact)
+    arena_release(&keys);
+  heap_free(ctrl);
+  heap_free(slots);
+  return false;
+}
+
+string_map_t *string_map_new(size_t cap) {
+  string_map_t *map = heap_alloc(sizeof(string_map_t), __func__);
+  if (unlikely(map == NULL))
+    return NULL;
+  size_t n = MAP_CAP_MIN;
+  while (n - n / 8 < cap && n <= SIZE_MAX / 4)
+    n *= 2;
+  map->ctrl = NULL;
+  map->slots = NULL;
+  map->cap = map->len = 0;
+  map->key_bytes = map->dead_bytes = 0;
+  map->seed = (uint64_t)(uintptr_t)map;
+  arena_init(&map->keys, 0);
+  if (unlikely(!map_resize(map, n, __func__))) {
+    heap_free(map);
+    return NULL;
+  }
+  return map;
+}
+
+void string_map_free(string_map_t *map) {
+  arena_release(&map->keys);
+  heap_free(map->ctrl);
+  heap_free(map->slots);
+  heap_free(map);
+}
+
+size_t string_map_len(const string_map_t *map) { return map->len; }
+
+bool string_map_insert(string_map_t *map, const string_t *key, void *value) {
+  uint64_t hash = hash_bytes(key->buf, key->len, map->seed);
+  size_t i = map_lookup(map, key->buf, key->len, hash);
+  if (i != NPOS) {
+    map->slots[i].value = value;
+    return true;
+  }
+  if (unlikely(map->growth_left == 0)) {
+    /* Grow, unless erasing has left enough deleted slots to reclaim. */
+    size_t cap = (map->len >= map->cap / 2) ? 2 * map->cap : map->cap;
+    if (unlikely(!map_resize(map, cap, __func__)))
+      return false;
+  } else if (unlikely(map->dead_bytes >= MAP_DEAD_MIN &&
+                      map->dead_bytes > map->key_bytes - map->dead_bytes)) {
+    /* Reclaim the erased keys; the map stays usable if this fails. */
+    (void)map_resize(map, map->cap, __func__);
+  }
+  string_t *k = string_dup(&map->keys, key->buf, key->len, __func__);
+  if (unlikely(k == NULL))
+    return false;
+  map->key_bytes += map_key_bytes(key->len);
+  i = map_free_slot(map->ctrl, map->cap, hash);
+  if (map->ctrl[i] == CTRL_EMPTY)
+    map->growth_left -= 1;
+  map->ctrl[i] = hash & 0x7f;
+  map->slots[i] = (map_slot_t){hash, k, value};
+  map->len += 1;
+  return true;
+}
+
+void **string_map_find_view(const string_map_t *map, string_view_t key) {
+  uint64_t hash = hash_bytes(key.buf, key.len, map->seed);
+  size_t i = map_lookup(map, key.buf, key.len, hash);
+  return (i == NPOS) ? NULL : &map->slots[i].value;
+}
+
+void **string_map_find(const string_map_t *map, const string_t *key) {
+  return string_map_find_view(map, string_view(key));
+}
+
+/*
+ * A lookup only probes past a group that had no empty slot. If the group
+ * of an erased key still has one, no lookup depends on the slot, which
+ * can become empty again; otherwise it is marked deleted.
+ */
+bool string_map_erase(string_map_t *map, const string_t *key) {
+  uint64_t hash = hash_bytes(key->buf, key->len, map->seed);
+  size_t i = map_lookup(map, key->buf, key->len, hash);
+  if (i == NPOS)
+    return false;
+  if (group_match(map->ctrl + (i & ~(size_t)(MAP_GROUP - 1)), CTRL_EMPTY)) {
+    map->ctrl[i] = CTRL_EMPTY;
+    map->growth_left += 1;
+  } else {
+    map->ctrl[i] = CTRL_DELETED;
+  }
+  map->dead_bytes += map_key_bytes(map->slots[i].key->len);
+  map->len -= 1;
+  return true;
+}
+
+bool string_map_next(const string_map_t *map, size_t *pos,
+                     const string_t **key, void **value) {
+  for (size_t i = *pos; i < map->cap; i++)
+    if (!(map->ctrl[i] & 0x80)) {
+      *key = map->slots[i].key;
+      *value = map->slots[i].value;
+      *pos = i + 1;
+      return true;
+    }
+  *pos = map->cap;
+  return false;
 }
 
-int string_vector_find(const string_vector_t *svec, const string_t *str) {
-  for (int i = 0; i <= svec->top; i++)
-    if (string_equal(svec->buf[i], str))
-      return i;
-  return -1;
+/*************************************************************************
+ *                           String Interning                            *
+ *************************************************************************/
+
+/*
+ * The strings are spread over INTERN_SHARDS shards by the top bits of
+ * their hashes. Each shard has a mutex for writers, an arena for the
+ * copies, and a linear probing table of slots that are filled once and
+ * never change afterwards. A writer stores the hash of a slot before
+ * publishing the string with release semantics, so that a reader that
+ * sees the string with acquire semantics also sees the hash, and needs no
+ * lock.
+ *
+ * A full table is replaced by one twice its size, which is published the
+ * same way. Readers may still be probing the old table, so it is kept
+ * until the intern table is freed. All replaced tables of a shard are
+ * smaller than its current table together.
+ */
+
+#define INTERN_SHARDS 16
+#define INTERN_CAP_MIN 64
+
+typedef struct {
+  uint64_t hash;
+  const string_t *str; /* NULL while the slot is empty */
+} intern_slot_t;
+
+typedef struct intern_table {
+  size_t mask;                  /* the number of slots minus 1 */
+  struct intern_table *retired; /* the table this one replaced */
+  intern_slot_t slots[];
+} intern_table_t;
+
+typedef struct {
+  intern_table_t *table;
+  size_t len;
+  pthread_mutex_t lock;
+  string_arena_t strs;
+} intern_shard_t;
+
+struct string_intern {
+  uint64_t seed;
+  intern_shard_t shards[INTERN_SHARDS];
+};
+
+static const string_t *intern_lookup(const intern_table_t *t, const char *buf,
+                                     size_t len, uint64_t hash) {
+  for (size_t i = hash & t->mask;; i = (i + 1) & t->mask) {
+    const string_t *s = __atomic_load_n(&t->slots[i].str, __ATOMIC_ACQUIRE);
+    if (s == NULL)
+      return NULL;
+    if (__atomic_load_n(&t->slots[i].hash, __ATOMIC_RELAXED) == hash &&
+        s->len == len && bytes_equal(s->buf, buf, len))
+      return s;
+  }
 }
 
-void string_vector_add(string_vector_t *svec, string_t *str) {
-  if (string_vector_is_full(svec))
-    string_vector_resize(svec);
-  svec->top += 1;
-  svec->buf[svec->top] = str;
+static void intern_publish(intern_table_t *t, uint64_t hash,
+                           const string_t *s) {
+  size_t i = hash & t->mask;
+  while (t->slots[i].str != NULL)
+    i = (i + 1) & t->mask;
+  __atomic_store_n(&t->slots[i].hash, hash, __ATOMIC_RELAXED);
+  __atomic_store_n(&t->slots[i].str, s, __ATOMIC_RELEASE);
 }
 
-/**********************************************************************/
+static intern_table_t *intern_table_new(size_t cap, const char *fn) {
+  if (unlikely(cap > (SIZE_MAX - sizeof(intern_table_t)) /
+                         sizeof(intern_slot_t)))
+    return NULL;
+  size_t size = sizeof(intern_table_t) + cap * sizeof(intern_slot_t);
+  intern_table_t *t = heap_alloc(size, fn);
+  if (unlikely(t == NULL))
+    return NULL;
+  memset(t, 0, size);
+  t->mask = cap - 1;
+  return t;
+}
 
-string_t *string_vector_remove(string_vector_t *svec, size_t index) {
-  if ((int)index > svec->top)
+/* Replaces the table of a locked shard by one with twice the slots. */
+static bool intern_grow(intern_shard_t *shard, const char *fn) {
+  intern_table_t *old = shard->table;
+  intern_table_t *t = intern_table_new(2 * (old->mask + 1), fn);
+  if (unlikely(t == NULL))
+    return false;
+  for (size_t i = 0; i <= old->mask; i++)
+    if (old->slots[i].str != NULL)
+      intern_publish(t, old->slots[i].hash, old->slots[i].str);
+  t->retired = old;
+  __atomic_store_n(&shard->table, t, __ATOMIC_RELEASE);
+  return true;
+}
+
+static inline intern_shard_t *intern_shard(const string_intern_t *intern,
+                                           uint64_t hash) {
+  return (intern_shard_t *)&intern->shards[hash >> 60];
+}
+
+string_intern_t *string_intern_new(void) {
+  string_intern_t *intern = heap_alloc(sizeof(string_intern_t), __func__);
+  if (unlikely(intern == NULL))
     return NULL;
-  string_t *str = svec->buf[index];
-  for (int i = index; i < svec->top; i++)
-    svec->buf[i] = svec->buf[i + 1];
-  svec->top -= 1;
-  return str;
+  intern->seed = (uint64_t)(uintptr_t)intern;
+  for (size_t i = 0; i < INTERN_SHARDS; i++) {
+    intern_shard_t *shard = &intern->shards[i];
+    shard->table = intern_table_new(INTERN_CAP_MIN, __func__);
+    if (unlikely(shard->table == NULL)) {
+      while (i--)
+        heap_free(intern->shards[i].table);
+      heap_free(intern);
+      return NULL;
+    }
+    shard->len = 0;
+    pthread_mutex_init(&shard->lock, NULL);
+    arena_init(&shard->strs, 0);
+  }
+  return intern;
 }
 
-/**********************************************************************/
+void string_intern_free(string_intern_t *intern) {
+  for (size_t i = 0; i < INTERN_SHARDS; i++) {
+    intern_shard_t *shard = &intern->shards[i];
+    for (intern_table_t *t = shard->table, *next; t != NULL; t = next) {
+      next = t->retired;
+      heap_free(t);
+    }
+    pthread_mutex_destroy(&shard->lock);
+    arena_release(&shard->strs);
+  }
+  heap_free(intern);
+}
 
-bool string_vector_equal(const string_vector_t *a, const string_vector_t *b) {
-  if (a->top != b->top)
+size_t string_intern_len(const string_intern_t *intern) {
+  size_t len = 0;
+  for (size_t i = 0; i < INTERN_SHARDS; i++)
+    len += __atomic_load_n(&intern->shards[i].len, __ATOMIC_RELAXED);
+  return len;
+}
+
+const string_t *string_intern_find(const string_intern_t *intern,
+                                   string_view_t v) {
+  uint64_t hash = hash_bytes(v.buf, v.len, intern->seed);
+  const intern_shard_t *shard = intern_shard(intern, hash);
+  return intern_lookup(__atomic_load_n(&shard->table, __ATOMIC_ACQUIRE), v.buf,
+                       v.len, hash);
+}
+
+const string_t *string_intern_view(string_intern_t *intern, string_view_t v) {
+  uint64_t hash = hash_bytes(v.buf, v.len, intern->seed);
+  intern_shard_t *shard = intern_shard(intern, hash);
+  const string_t *s = intern_lookup(
+      __atomic_load_n(&shard->table, __ATOMIC_ACQUIRE), v.buf, v.len, hash);
+  if (likely(s != NULL))
+    return s;
+
+  pthread_mutex_lock(&shard->lock);
+  /* Another thread may have interned the string since the lookup. */
+  s = intern_lookup(shard->table, v.buf, v.len, hash);
+  if (s == NULL && (2 * (shard->len + 1) <= shard->table->mask + 1 ||
+                    intern_grow(shard, __func__))) {
+    s = string_dup(&shard->strs, v.buf, v.len, __func__);
+    if (likely(s != NULL)) {
+      intern_publish(shard->table, hash, s);
+      __atomic_store_n(&shard->len, shard->len + 1, __ATOMIC_RELAXED);
+    }
+  }
+  pthread_mutex_unlock(&shard->lock);
+  return s;
+}
+
+const string_t *string_intern(string_intern_t *intern, const string_t *str) {
+  return string_intern_view(intern, string_view(str));
+}
+
+/*************************************************************************
+ *                          String Builder                               *
+ *************************************************************************/
+
+/*
+ * The builder keeps its contents in a heap allocated string_t whose length
+ * field is the current length, so that string_builder_finish() only has to
+ * shrink the allocation. One byte beyond the capacity is always allocated
+ * for the terminating null byte written by vsnprintf().
+ */
+
+#define BUILDER_CAP_DEFAULT 64
+
+struct string_builder {
+  size_t cap;
+  string_t *str;
+};
+
+static bool builder_grow(string_builder_t *sb, size_t n, const char *fn) {
+  size_t len = sb->str->len;
+  if (likely(n <= sb->cap - len))
+    return true;
+  if (unlikely(n > SIZE_MAX / 2 - sizeof(string_t) - len))
     return false;
-  for (int i = 0; i <= a->top; i++)
-    if (!string_equal(a->buf[i], b->buf[i]))
+  size_t cap = (2 * sb->cap > len + n) ? 2 * sb->cap : len + n;
+  string_t *s = heap_realloc(sb->str, sizeof(string_t) + cap + 1, fn);
+  if (unlikely(s == NULL))
+    return false;
+  sb->str = s;
+  sb->cap = cap;
+  return true;
+}
+
+static inline bool builder_append(string_builder_t *sb, const char *buf,
+                                  size_t n, const char *fn) {
+  if (unlikely(!builder_grow(sb, n, fn)))
+    return false;
+  memcpy(sb->str->buf + sb->str->len, buf, n);
+  sb->str->len += n;
+  return true;
+}
+
+string_builder_t *string_builder_new(size_t capacity) {
+  string_builder_t *sb = heap_alloc(sizeof(string_builder_t), __func__);
+  if (unlikely(sb == NULL))
+    return NULL;
+  sb->cap = capacity ? capacity : BUILDER_CAP_DEFAULT;
+  sb->str = string_alloc(NULL, sb->cap + 1, __func__);
+  if (unlikely(sb->str == NULL)) {
+    heap_free(sb);
+    return NULL;
+  }
+  sb->str->len = 0;
+  return sb;
+}
+
+void string_builder_free(string_builder_t *sb) {
+  heap_free(sb->str);
+  heap_free(sb);
+}
+
+bool string_builder_reserve(string_builder_t *sb, size_t n) {
+  return builder_grow(sb, n, __func__);
+}
+
+bool string_builder_append(string_builder_t *sb, const string_t *str) {
+  return builder_append(sb, str->buf, str->len, __func__);
+}
+
+bool string_builder_append_cstr(string_builder_t *sb, const char *cstr) {
+  return builder_append(sb, cstr, strlen(cstr), __func__);
+}
+
+bool string_builder_append_char(string_builder_t *sb, char c) {
+  if (unlikely(sb->str->len == sb->cap) &&
+      unlikely(!builder_grow(sb, 1, __func__)))
+    return false;
+  sb->str->buf[sb->str->len++] = c;
+  return true;
+}
+
+bool string_builder_append_int(string_builder_t *sb, long long value) {
+  char digits[24], *p = digits + sizeof(digits);
+  unsigned long long u = value;
+  if (value < 0)
+    u = -u;
+  do {
+    *--p = '0' + u % 10;
+    u /= 10;
+  } while (u);
+  if (value < 0)
+    *--p = '-';
+  return builder_append(sb, p, digits + sizeof(digits) - p, __func__);
+}
+
+bool string_builder_append_format(string_builder_t *sb, const char *fmt,
+                                  ...) {
+  va_list ap, aq;
+  va_start(ap, fmt);
+  va_copy(aq, ap);
+  size_t len = sb->str->len, room = sb->cap - len + 1;
+  int n = vsnprintf(sb->str->buf + len, room, fmt, ap);
+  va_end(ap);
+  if (unlikely(n < 0)) {
+    va_end(aq);
+    return false;
+  }
+  if ((size_t)n >= room) {
+    if (unlikely(!builder_grow(sb, n, __func__))) {
+      va_end(aq);
       return false;
+    }
+    vsnprintf(sb->str->buf + len, n + 1, fmt, aq);
+  }
+  va_end(aq);
+  sb->str->len += n;
   return true;
 }
 
-/**********************************************************************/
+size_t string_builder_len(const string_builder_t *sb) { return sb->str->len; }
 
-string_vector_t *string_vector_map(strfunc_t func,
-                                   const string_vector_t *svec) {
-  if (string_vector_len(svec) == 0)
-    return string_vector_empty();
+string_view_t string_builder_view(const string_builder_t *sb) {
+  return (string_view_t){sb->str->len, sb->str->buf};
+}
 
-  string_vector_t *res = malloc(sizeof(string_vector_t));
-  if (unlikely(!res))
+string_t *string_builder_finish(string_builder_t *sb) {
+  string_t *s = sb->str;
+  if (s->len < sb->cap) {
+    string_t *t = heap_realloc(s, sizeof(string_t) + s->len, __func__);
+    if (likely(t != NULL))
+      s = t;
+  }
+  heap_free(sb);
+  return s;
+}
+
+/*************************************************************************
+ *                        Memory-Mapped Files                            *
+ *************************************************************************/
+
+/*
+ * A mapped file is laid out as one anonymous page followed by the file
+ * mapping, with the string_t header at the end of the anonymous page so
+ * that its buffer starts exactly at the first byte of the file. The
+ * address range is reserved without access, so that it is not charged
+ * against the commit limit, and only the header page is made writable.
+ */
+
+const string_t *string_mmap_file(const char *path, int flags) {
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (unlikely(fd < 0))
     return NULL;
-  res->buf = malloc(svec->cap * sizeof(string_t *));
-  res->cap = svec->cap;
-  res->top = svec->top;
-  memcpy(res->buf, svec->buf, svec->top * sizeof(string_t *));
 
-  for (int i = 0; i <= svec->top; i++)
-    res->buf[i] = func(svec->buf[i]);
+  struct stat st;
+  char *base = MAP_FAILED;
+  size_t page = sysconf(_SC_PAGESIZE), len = 0;
+  if (unlikely(fstat(fd, &st) != 0))
+    goto fail;
+  if (unlikely(!S_ISREG(st.st_mode))) {
+    errno = EINVAL;
+    goto fail;
+  }
+  if (unlikely((uintmax_t)st.st_size > SIZE_MAX - page)) {
+    errno = EFBIG;
+    goto fail;
+  }
+  len = st.st_size;
 
-  return res;
+  base = mmap(NULL, page + len, PROT_NONE,
+              MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (unlikely(base == MAP_FAILED))
+    goto fail;
+  if (len > 0) {
+    if (unlikely(mmap(base + page, len, PROT_READ, MAP_PRIVATE | MAP_FIXED,
+                      fd, 0) == MAP_FAILED))
+      goto fail;
+    if (flags & STRING_MMAP_SEQUENTIAL)
+      madvise(base + page, len, MADV_SEQUENTIAL);
+    if (flags & STRING_MMAP_RANDOM)
+      madvise(base + page, len, MADV_RANDOM);
+    if (flags & STRING_MMAP_WILLNEED)
+      madvise(base + page, len, MADV_WILLNEED);
+  }
+  if (unlikely(mprotect(base, page, PROT_READ | PROT_WRITE) != 0))
+    goto fail;
+  string_t *s = (string_t *)(base + page - sizeof(string_t));
+  s->len = len;
+  if (unlikely(mprotect(base, page, PROT_READ) != 0))
+    goto fail;
+  close(fd);
+  return s;
+
+fail:;
+  int err = errno;
+  if (base != MAP_FAILED)
+    munmap(base, page + len);
+  close(fd);
+  errno = err;
+  return NULL;
 }
 
-/**********************************************************************/
+void string_munmap(const string_t *str) {
+  size_t page = sysconf(_SC_PAGESIZE);
+  munmap((char *)str->buf - page, page + str->len);
+}
 
-string_vector_t *string_vector_filter(strboolfunc_t func,
-                                      const string_vector_t *svec) {
-  string_vector_t *res = string_vector_empty();
-  if (unlikely(!res))
+/*************************************************************************
+ *                            Line Reader                                *
+ *************************************************************************/
+
+/*
+ * The unread input is buf[start, end). When no newline is left in it, the
+ * unread bytes are moved to the front of the buffer, which is doubled if
+ * they fill it, and more input is read. `scanned` counts the unread bytes
+ * already known to contain no newline, so that a long line is scanned only
+ * once however often the buffer is refilled.
+ */
+
+#define LINE_BUF_DEFAULT (256 * 1024)
+
+struct string_line_reader {
+  int fd;
+  int error;
+  bool eof;
+  char *buf;
+  size_t cap, start, end, scanned;
+};
+
+string_line_reader_t *string_line_reader_new(int fd, size_t buffer_size) {
+  string_line_reader_t *r = heap_alloc(sizeof(string_line_reader_t), __func__);
+  if (unlikely(r == NULL))
     return NULL;
-  for (int i = 0; i <= svec->top; i++)
-    if (func(svec->buf[i]))
-      string_vector_add(res, string_clone(svec->buf[i]));
+  r->cap = buffer_size ? buffer_size : LINE_BUF_DEFAULT;
+  r->buf = heap_alloc(r->cap, __func__);
+  if (unlikely(r->buf == NULL)) {
+    heap_free(r);
+    return NULL;
+  }
+  r->fd = fd;
+  r->error = 0;
+  r->eof = false;
+  r->start = r->end = r->scanned = 0;
+  return r;
+}
 
-  return res;
+void string_line_reader_free(string_line_reader_t *r) {
+  heap_free(r->buf);
+  heap_free(r);
+}
+
+static bool line_reader_fill(string_line_reader_t *r, const char *fn) {
+  if (r->start > 0) {
+    memmove(r->buf, r->buf + r->start, r->end - r->start);
+    r->end -= r->start;
+    r->start = 0;
+  }
+  if (r->end == r->cap &&
+      unlikely(!array_grow((void **)&r->buf, &r->cap, 1, fn))) {
+    r->error = ENOMEM;
+    return false;
+  }
+  ssize_t n;
+  while ((n = read(r->fd, r->buf + r->end, r->cap - r->end)) < 0)
+    if (errno != EINTR) {
+      r->error = errno;
+      return false;
+    }
+  if (n == 0)
+    r->eof = true;
+  r->end += n;
+  return true;
+}
+
+bool string_line_reader_next(string_line_reader_t *r, string_view_t *line,
+                             enum string_line_ending *ending) {
+  for (;;) {
+    char *p = r->buf + r->start;
+    char *q = memchr(p + r->scanned, '\n', r->end - r->start - r->scanned);
+    if (likely(q != NULL)) {
+      bool crlf = q > p && q[-1] == '\r';
+      *line = (string_view_t){q - p - crlf, p};
+      if (ending)
+        *ending = crlf ? STRING_EOL_CRLF : STRING_EOL_LF;
+      r->start = q + 1 - r->buf;
+      r->scanned = 0;
+      return true;
+    }
+    r->scanned = r->end - r->start;
+
+    if (r->eof) {
+      if (r->start == r->end)
+        return false;
+      *line = (string_view_t){r->end - r->start, p};
+      if (ending)
+        *ending = STRING_EOL_NONE;
+      r->start = r->end;
+      r->scanned = 0;
+      return true;
+    }
+    if (unlikely(r->error != 0 || !line_reader_fill(r, __func__)))
+      return false;
+  }
+}
+
+int string_line_reader_error(const string_line_reader_t *r) {
+  return r->error;
+}
+
+/*************************************************************************
+ *                        Multi-Pattern Search                           *
+ *************************************************************************/
+
+/*
+ * Aho-Corasick automaton. States are numbered in breadth-first order, so
+ * the shallow states visited most often are packed together at the start
+ * of the state array. The root and its children have dense 256-entry
+ * transition tables with the failure links already resolved, so a scan
+ * that stays near the root does one load per byte and no branches. Every
+ * deeper state owns a run of byte-sorted edges in the shared edge arrays
+ * and falls back to its failure link when no edge matches.
+ */
+
+typedef struct {
+  uint32_t fail;   /* longest proper suffix that is also a trie state */
+  uint32_t dict;   /* nearest state on the failure chain with output */
+  uint32_t edges;  /* index of the first edge of this state */
+  uint16_t nedges; /* number of edges */
+  int32_t out;     /* first pattern ending in this state, or -1 */
+} ac_state_t;
+
+struct string_matcher {
+  uint32_t (*dense)[256]; /* transitions of states 0 .. ndense - 1 */
+  uint32_t ndense;
+  bool skip; /* few bytes start a pattern, skip the others quickly */
+  ac_state_t *states;
+  unsigned char *ebyte;
+  uint32_t *etarget;
+  size_t *plen;  /* length of every pattern */
+  int32_t *same; /* next pattern ending in the same state, or -1 */
+  size_t npatterns;
+};
+
+/* Trie node used while building the automaton. */
+typedef struct {
+  uint32_t first; /* first child, children are sorted by byte */
+  uint32_t next;  /* next sibling */
+  int32_t out;
+  unsigned char c;
+} ac_node_t;
+
+static uint32_t ac_child(const ac_node_t *t, uint32_t u, unsigned char c) {
+  for (uint32_t v = t[u].first; v; v = t[v].next) {
+    if (t[v].c == c)
+      return v;
+    if (t[v].c > c)
+      break;
+  }
+  return 0;
+}
+
+static uint32_t ac_insert(ac_node_t *t, uint32_t *n, uint32_t u,
+                          unsigned char c) {
+  uint32_t *link = &t[u].first;
+  while (*link && t[*link].c < c)
+    link = &t[*link].next;
+  if (*link && t[*link].c == c)
+    return *link;
+
+  uint32_t v = (*n)++;
+  t[v].first = 0;
+  t[v].next = *link;
+  t[v].out = -1;
+  t[v].c = c;
+  *link = v;
+  return v;
+}
+
+void string_matcher_free(string_matcher_t *mt) {
+  heap_free(mt->dense);
+  heap_free(mt->states);
+  heap_free(mt->ebyte);
+  heap_free(mt->etarget);
+  heap_free(mt->plen);
+  heap_free(mt->same);
+  heap_free(mt);
+}
+
+string_matcher_t *string_matcher_new(const string_vector_t *patterns) {
+  size_t np = string_vector_len(patterns), total = 1;
+  for (size_t i = 0; i < np; i++)
+    total += patterns->buf[i]->len;
+  if (unlikely(total > UINT32_MAX || np > INT32_MAX))
+    return NULL;
+
+  string_matcher_t *mt = heap_alloc(sizeof(string_matcher_t), __func__);
+  if (unlikely(mt == NULL))
+    return NULL;
+  memset(mt, 0, sizeof(string_matcher_t));
+  mt->npatterns = np;
+  mt->plen = heap_alloc((np ? np : 1) * sizeof(size_t), __func__);
+  mt->same = heap_alloc((np ? np : 1) * sizeof(int32_t), __func__);
+  mt->states = heap_alloc(total * sizeof(ac_state_t), __func__);
+  mt->ebyte = heap_alloc(total, __func__);
+  mt->etarget = heap_alloc(total * sizeof(uint32_t), __func__);
+  ac_node_t *trie = heap_alloc(total * sizeof(ac_node_t), __func__);
+  uint32_t *order = heap_alloc(total * sizeof(uint32_t), __func__);
+  uint32_t *fail = heap_alloc(total * sizeof(uint32_t), __func__);
+  uint32_t *id = heap_alloc(total * sizeof(uint32_t), __func__);
+  if (unlikely(!mt->plen || !mt->same || !mt->states || !mt->ebyte ||
+               !mt->etarget || !trie || !order || !fail || !id)) {
+    string_matcher_free(mt);
+    mt = NULL;
+    goto out;
+  }
+
+  /* Build the trie. Patterns are inserted last to first, so that the
+     output chain of every state lists its patterns in ascending order. */
+  uint32_t n = 1;
+  trie[0].first = trie[0].next = 0;
+  trie[0].out = -1;
+  for (size_t i = np; i-- > 0;) {
+    const string_t *p = patterns->buf[i];
+    uint32_t u = 0;
+    for (size_t j = 0; j < p->len; j++)
+      u = ac_insert(trie, &n, u, (unsigned char)p->buf[j]);
+    mt->plen[i] = p->len;
+    mt->same[i] = -1;
+    if (p->len) {
+      mt->same[i] = trie[u].out;
+      trie[u].out = (int32_t)i;
+    }
+  }
+
+  /* Compute the failure links in breadth-first order. */
+  uint32_t head = 0, tail = 1;
+  order[0] = 0;
+  fail[0] = 0;
+  while (head < tail) {
+    uint32_t u = order[head++];
+    for (uint32_t v = trie[u].first; v; v = trie[v].next) {
+      order[tail++] = v;
+      uint32_t f = fail[u];
+      while (f && !ac_child(trie, f, trie[v].c))
+        f = fail[f];
+      fail[v] = (u == 0) ? 0 : ac_child(trie, f, trie[v].c);
+    }
+  }
+
+  /* Lay the states out in breadth-first order. */
+  for (uint32_t k = 0; k < n; k++)
+    id[order[k]] = k;
+  mt->ndense = 1;
+  for (uint32_t v = trie[0].first; v; v = trie[v].next)
+    mt->ndense += 1;
+  mt->skip = mt->ndense <= 16;
+  mt->dense = heap_alloc(mt->ndense * sizeof(*mt->dense), __func__);
+  if (unlikely(mt->dense == NULL)) {
+    string_matcher_free(mt);
+    mt = NULL;
+    goto out;
+  }
+  memset(mt->dense, 0, mt->ndense * sizeof(*mt->dense));
+  uint32_t e = 0;
+  for (uint32_t k = 0; k < n; k++) {
+    uint32_t u = order[k];
+    ac_state_t *st = &mt->states[k];
+    st->fail = id[fail[u]];
+    st->out = trie[u].out;
+    st->edges = e;
+    if (k > 0 && k < mt->ndense)
+      memcpy(mt->dense[k], mt->dense[0], sizeof(mt->dense[0]));
+    for (uint32_t v = trie[u].first; v; v = trie[v].next) {
+      if (k < mt->ndense)
+        mt->dense[k][trie[v].c] = id[v];
+      mt->ebyte[e] = trie[v].c;
+      mt->etarget[e++] = id[v];
+    }
+    st->nedges = (uint16_t)(e - st->edges);
+    if (k == 0) {
+      st->dict = 0;
+    } else {
+      const ac_state_t *f = &mt->states[st->fail];
+      st->dict = (f->out >= 0) ? st->fail : f->dict;
+    }
+  }
+
+out:
+  heap_free(trie);
+  heap_free(order);
+  heap_free(fail);
+  heap_free(id);
+  return mt;
+}
+
+static inline uint32_t ac_step(const string_matcher_t *mt, uint32_t s,
+                               unsigned char c) {
+  while (s >= mt->ndense) {
+    const ac_state_t *st = &mt->states[s];
+    const unsigned char *b = mt->ebyte + st->edges;
+    for (uint32_t k = 0; k < st->nedges && b[k] <= c; k++)
+      if (b[k] == c)
+        return mt->etarget[st->edges + k];
+    s = st->fail;
+  }
+  return mt->dense[s][c];
+}
+
+/*
+ * Runs the automaton from state *state over str[i..] and stops after the
+ * first byte that completes a match. Returns the offset one past that
+ * byte, or 0 if the end of the string was reached without a match. With
+ * `skip` set, bytes that cannot start a pattern are skipped in a tight
+ * loop whenever the automaton is in the root; callers pass a constant so
+ * that the common case does not pay for the extra branch.
+ */
+static inline __attribute__((always_inline)) size_t
+ac_scan(const string_matcher_t *mt, const string_t *str, size_t i,
+        uint32_t *state, bool skip) {
+  const unsigned char *b = (const unsigned char *)str->buf;
+  uint32_t s = *state;
+  for (; i < str->len; i++) {
+    if (skip && s == 0) {
+      while (i < str->len && mt->dense[0][b[i]] == 0)
+        i += 1;
+      if (i == str->len)
+        break;
+    }
+    s = ac_step(mt, s, b[i]);
+    if (mt->states[s].out >= 0 || mt->states[s].dict) {
+      *state = s;
+      return i + 1;
+    }
+  }
+  *state = s;
+  return 0;
+}
+
+static size_t ac_next(const string_matcher_t *mt, const string_t *str,
+                      size_t i, uint32_t *state) {
+  return mt->skip ? ac_scan(mt, str, i, state, true)
+                  : ac_scan(mt, str, i, state, false);
+}
+
+bool string_matcher_any(const string_matcher_t *mt, const string_t *str) {
+  uint32_t s = 0;
+  return ac_next(mt, str, 0, &s) != 0;
+}
+
+string_match_t *string_matcher_find_all(const string_matcher_t *mt,
+                                        const string_t *str, size_t *count) {
+  size_t n = 0, cap = CAP_DEFAULT;
+  string_match_t *hits = heap_alloc(cap * sizeof(string_match_t), __func__);
+  if (unlikely(hits == NULL))
+    return NULL;
+
+  uint32_t s = 0;
+  for (size_t e = 0; (e = ac_next(mt, str, e, &s)) != 0;) {
+    uint32_t t = (mt->states[s].out >= 0) ? s : mt->states[s].dict;
+    for (; t; t = mt->states[t].dict) {
+      for (int32_t p = mt->states[t].out; p >= 0; p = mt->same[p]) {
+        if (n == cap && unlikely(!array_grow((void **)&hits, &cap,
+                                             sizeof(string_match_t),
+                                             __func__))) {
+          heap_free(hits);
+          return NULL;
+        }
+        hits[n].pattern = (size_t)p;
+        hits[n].offset = e - mt->plen[p];
+        n += 1;
+      }
+    }
+  }
+  *count = n;
+  return hits;
 }
 
 /**********************************************************************/
 
-string_t *string_vector_reduce(reducefunc_t func, const string_vector_t *svec,
-                               string_t *initializer) {
-  string_t *val = (initializer) ? string_clone(initializer) : string_new("");
+typedef struct {
+  size_t start, end, pattern;
+} span_t;
 
-  for (int i = 0; i <= svec->top; i++) {
-    string_t *t = func(val, svec->buf[i]);
-    free(val);
-    val = t;
+static bool span_push(span_t **buf, size_t *n, size_t *cap, span_t sp,
+                      const char *fn) {
+  if (*n == *cap &&
+      unlikely(!array_grow((void **)buf, cap, sizeof(span_t), fn)))
+    return false;
+  (*buf)[(*n)++] = sp;
+  return true;
+}
+
+/*
+ * Moves the leftmost-longest pending match into the selection, or all of
+ * them if `flush` is set. A pending match is settled once `pos` is so far
+ * past its start that no later match can start at or before it.
+ */
+static bool replace_settle(span_t *pend, size_t *npend, span_t **sel,
+                           size_t *nsel, size_t *scap, size_t pos,
+                           size_t maxlen, bool flush, const char *fn) {
+  while (*npend) {
+    size_t best = 0;
+    for (size_t k = 1; k < *npend; k++)
+      if (pend[k].start < pend[best].start ||
+          (pend[k].start == pend[best].start && pend[k].end > pend[best].end))
+        best = k;
+    if (!flush && pos < pend[best].start + maxlen)
+      return true;
+    if (unlikely(!span_push(sel, nsel, scap, pend[best], fn)))
+      return false;
+
+    size_t cursor = pend[best].end, k = 0;
+    for (size_t j = 0; j < *npend; j++)
+      if (pend[j].start >= cursor)
+        pend[k++] = pend[j];
+    *npend = k;
   }
-  return val;
+  return true;
+}
+
+string_t *string_replace_many(const string_t *str, const string_vector_t *old,
+                              const string_vector_t *new) {
+  if (unlikely(string_vector_len(old) != string_vector_len(new)))
+    return NULL;
+
+  string_matcher_t *mt = string_matcher_new(old);
+  if (unlikely(mt == NULL))
+    return NULL;
+
+  size_t maxlen = 0;
+  for (size_t p = 0; p < mt->npatterns; p++)
+    maxlen = (mt->plen[p] > maxlen) ? mt->plen[p] : maxlen;
+
+  size_t npend = 0, pcap = CAP_DEFAULT, nsel = 0, scap = CAP_DEFAULT;
+  span_t *pend = heap_alloc(pcap * sizeof(span_t), __func__);
+  span_t *sel = heap_alloc(scap * sizeof(span_t), __func__);
+  string_t *s = NULL;
+  if (unlikely(pend == NULL || sel == NULL))
+    goto out;
+
+  uint32_t st = 0;
+  size_t cursor = 0;
+  for (size_t e = 0; (e = ac_next(mt, str, e, &st)) != 0;) {
+    uint32_t t = (mt->states[st].out >= 0) ? st : mt->states[st].dict;
+    for (; t; t = mt->states[t].dict) {
+      for (int32_t p = mt->states[t].out; p >= 0; p = mt->same[p]) {
+        span_t sp = {e - mt->plen[p], e, (size_t)p};
+        if (sp.start >= cursor &&
+            unlikely(!span_push(&pend, &npend, &pcap, sp, __func__)))
+          goto out;
+      }
+    }
+    if (unlikely(!replace_settle(pend, &npend, &sel, &nsel, &scap, e, maxlen,
+                                 false, __func__)))
+      goto out;
+    if (nsel)
+      cursor = sel[nsel - 1].end;
+  }
+  if (unlikely(!replace_settle(pend, &npend, &sel, &nsel, &scap, str->len,
+                               maxlen, true, __func__)))
+    goto out;
+
+  size_t len = str->len;
+  for (size_t i = 0; i < nsel; i++)
+    len = len - (sel[i].end - sel[i].start) + new->buf[sel[i].pattern]->len;
+  s = string_alloc(NULL, len, __func__);
+  if (unlikely(s == NULL))
+    goto out;
+
+  char *t = s->buf;
+  size_t curr = 0;
+  for (size_t i = 0; i < nsel; i++) {
+    const string_t *r = new->buf[sel[i].pattern];
+    memcpy(t, str->buf + curr, sel[i].start - curr);
+    t += sel[i].start - curr;
+    memcpy(t, r->buf, r->len);
+    t += r->len;
+    curr = sel[i].end;
+  }
+  memcpy(t, str->buf + curr, str->len - curr);
+
+out:
+  heap_free(pend);
+  heap_free(sel);
+  string_matcher_free(mt);
+  return s;
 }
 
 /**********************************************************************/
@@ -24,6 +24,8 @@ typedef struct {
   char buf[];
 } string_t;
 
+typedef struct string_arena string_arena_t;
+
 /**
  * Creates a new colored string_t initialized with the provided character array.
  *
@@ -48,6 +50,19 @@ string_t *string_colored(const char *str, enum stringcolor c);
  **/
 string_t *string_new(const char *str);
 
+/**
+ * Allocates a new string_t initialized with the first `len` bytes of the
+ * provided character array, which may contain null bytes.
+ *
+ * @param str The character array to initialize the string with.
+ * @param len The number of bytes to copy.
+ * @return A pointer to the newly allocated string_t object, or NULL if
+ *         memory allocation failed. The returned string must be deallocated
+ *         using the standard C library function `free()` when no longer
+ *         needed.
+ **/
+string_t *string_nnew(const char *str, size_t len);
+
 /**
  * Creates a new string_t object as a copy of the provided string.
  *
@@ -61,20 +76,24 @@ string_t *string_new(const char *str);
 string_t *string_clone(const string_t *str);
 
 /**
- * Reads up to 64 KB of data from the specified file descriptor and
- * creates a new string containing the read data.
+ * Reads all data from the specified file descriptor until the end of file
+ * and creates a new string containing the read data, including any null
+ * bytes. Regular files are read into a single allocation of the remaining
+ * file size.
  *
  * @param fd The file descriptor to read from.
- * @return A pointer to the newly allocated string_t containing the read data
- *         or an empty string if an error occurred or the end of the file has
- *         been reached. The returned string must be deallocated using the
- *         standard C library function `free()` when no longer needed.
+ * @return A pointer to the newly allocated string_t containing the read data,
+ *         an empty string if a read error occurred or the end of the file
+ *         has been reached, or NULL if memory allocation failed. The
+ *         returned string must be deallocated using the standard C library
+ *         function `free()` when no longer needed.
  **/
 string_t *string_readfd(int fd);
 
 /**
- * Reads a line from a file stream, with a maximum of 64 KB of data,
- * and stores it as a newly allocated string.
+ * Reads a line from a file stream and stores it without the terminating
+ * newline as a newly allocated string. To iterate over many lines, use a
+ * `string_line_reader_t`, which does not allocate per line.
  *
  * @param stream The file stream to read from.
  * @return A pointer to the newly allocated string containing the read line or
@@ -99,7 +118,7 @@ string_t *string_concat(const string_t *s1, const string_t *s2);
 
 /**
  * Creates a new string by removing leading and trailing whitespace characters
- * from the provided string.
+ * (ASCII space, \\t, \\n, \\v, \\f, and \\r) from the provided string.
  *
  * @param str The input string to trim.
  * @return A pointer to a newly allocated string containing the trimmed
@@ -115,7 +134,8 @@ string_t *string_trim(const string_t *str);
  * @param s1 The first string to compare.
  * @param s2 The second string to compare.
  * @return An integer greater than, equal to, or less than 0 if s1 is greater
- *         than, equal to, or less than s2, respectively.
+ *         than, equal to, or less than s2, respectively. The strings are
+ *         compared as unsigned bytes, including null bytes.
  **/
 int string_compare(const string_t *s1, const string_t *s2);
 
@@ -129,6 +149,85 @@ int string_compare(const string_t *s1, const string_t *s2);
  **/
 bool string_equal(const string_t *s1, const string_t *s2);
 
+/**
+ * Pairs a string with the hash of its contents, so that unequal strings
+ * can usually be told apart by comparing the hashes. The hash is not
+ * updated; the string must not change while it is in use.
+ **/
+typedef struct {
+  const string_t *str; /* the string, not owned */
+  uint64_t hash;       /* the hash of the contents of str */
+} string_hashed_t;
+
+/**
+ * Computes the hash of a string.
+ *
+ * @param str The string to hash.
+ * @return The string paired with its hash.
+ **/
+string_hashed_t string_hashed(const string_t *str);
+
+/**
+ * Checks if two hashed strings have equal contents. The contents are only
+ * compared if the hashes are equal.
+ *
+ * @param a The first hashed string.
+ * @param b The second hashed string.
+ * @return True if the contents of a and b are equal, false otherwise.
+ **/
+bool string_hashed_equal(string_hashed_t a, string_hashed_t b);
+
+/**
+ * Computes a 64-bit hash of the contents of a string. The hash is fast and
+ * well distributed but not cryptographic. Equal strings have equal hashes
+ * for the same seed, within one version of libstring.
+ *
+ * @param str The string to hash.
+ * @param seed The seed. A secret random seed makes it hard to construct
+ *        colliding inputs, for example for hash tables filled from
+ *        untrusted data.
+ * @return The hash of the string.
+ **/
+uint64_t string_hash(const string_t *str, uint64_t seed);
+
+/**
+ * The state of an incremental hash, which computes the same hash as
+ * `string_hash()` for the concatenation of all parts hashed, however the
+ * input is divided. Its fields are private.
+ **/
+typedef struct {
+  uint64_t state[3];
+  size_t len;     /* number of bytes hashed so far */
+  size_t pending; /* number of bytes buffered but not yet mixed in */
+  char buf[64];
+} string_hasher_t;
+
+/**
+ * Starts an incremental hash.
+ *
+ * @param h The hasher to initialize.
+ * @param seed The seed, as for `string_hash()`.
+ **/
+void string_hasher_init(string_hasher_t *h, uint64_t seed);
+
+/**
+ * Adds the next part of the input to an incremental hash.
+ *
+ * @param h The hasher.
+ * @param buf The bytes to add.
+ * @param len The number of bytes to add.
+ **/
+void string_hasher_update(string_hasher_t *h, const char *buf, size_t len);
+
+/**
+ * Returns the hash of all parts added so far. The hasher is not changed
+ * and more parts can be added afterwards.
+ *
+ * @param h The hasher.
+ * @return The hash of the input added so far.
+ **/
+uint64_t string_hasher_final(const string_hasher_t *h);
+
 /**
  * Creates a new string that represents a substring of the input string.
  *
@@ -174,6 +273,61 @@ int string_substring_index(const string_t *str, const string_t *substring);
  */
 bool string_is_substring(const string_t *str, const string_t *sub, size_t off);
 
+/**********************************************************************/
+
+typedef struct string_needle string_needle_t;
+
+/**
+ * Compiles a needle for repeated substring searches.
+ *
+ * All per-needle preprocessing (selection of the rarest bytes for the
+ * vectorized filter and the Two-Way factorization) is done once here, so
+ * that searching with the returned needle only pays for the scan.
+ *
+ * @param str The substring to search for. The needle keeps its own copy.
+ * @return A pointer to the newly allocated needle, or NULL if memory
+ *         allocation failed. The returned needle must be deallocated using
+ *         the standard C library function `free()` when no longer needed.
+ **/
+string_needle_t *string_needle_new(const string_t *str);
+
+/**
+ * Finds the first occurrence of a compiled needle within a string.
+ *
+ * @param needle The compiled needle.
+ * @param str The input string to search in.
+ * @return The index of the first occurrence of the needle in the input
+ *         string, or -1 if not found.
+ **/
+int string_needle_find(const string_needle_t *needle, const string_t *str);
+
+/**
+ * Counts the non-overlapping occurrences of a compiled needle within a
+ * string.
+ *
+ * @param needle The compiled needle.
+ * @param str The input string to search in.
+ * @return The number of non-overlapping occurrences.
+ **/
+size_t string_needle_count(const string_needle_t *needle, const string_t *str);
+
+/**
+ * Finds all non-overlapping occurrences of a compiled needle within a
+ * string.
+ *
+ * @param needle The compiled needle.
+ * @param str The input string to search in.
+ * @param count Receives the number of occurrences found.
+ * @return A pointer to a newly allocated array of `*count` ascending
+ *         offsets, or NULL if memory allocation failed. The returned array
+ *         must be deallocated using the standard C library function `free()`
+ *         when no longer needed.
+ **/
+size_t *string_needle_find_all(const string_needle_t *needle,
+                               const string_t *str, size_t *count);
+
+/**********************************************************************/
+
 /**
  * Creates a new string by repeating the input string multiple times.
  *
@@ -204,6 +358,35 @@ string_t *string_repeat(const string_t *str, size_t times);
  **/
 string_t *string_replace_char(const string_t *str, char old, char new);
 
+/**
+ * Counts the occurrences of a character in a string.
+ *
+ * @param str The input string.
+ * @param c The character to count.
+ * @return The number of occurrences of `c` in the input string.
+ **/
+size_t string_count_char(const string_t *str, char c);
+
+/**
+ * Finds the first occurrence of a character in a string.
+ *
+ * @param str The input string to search in.
+ * @param c The character to search for.
+ * @return The index of the first occurrence of `c` in the input string,
+ *         or -1 if not found.
+ **/
+int string_find_char(const string_t *str, char c);
+
+/**
+ * Finds the first character of a string that belongs to a set.
+ *
+ * @param str The input string to search in.
+ * @param set The characters to search for.
+ * @return The index of the first character of the input string that occurs
+ *         in `set`, or -1 if there is none.
+ **/
+int string_find_any_of(const string_t *str, const string_t *set);
+
 /* Creates a new string where all occurrences of the 'old' substring
  * in the input string are replaced with the 'new' substring.
  *
@@ -213,8 +396,8 @@ string_t *string_replace_char(const string_t *str, char old, char new);
  * @return A new string with replaced substrings. Must be freed after use.
  * @note The returned string is allocated on the heap and must be freed by the
  * caller.
- * @note If 'old' is not found in the input string, the function returns a copy
- * of the input string.
+ * @note If 'old' is not found in the input string or is empty, the function
+ * returns a copy of the input string.
  **/
 string_t *string_replace(const string_t *str, const string_t *old,
                          const string_t *new);
@@ -353,6 +536,36 @@ string_t *string_map(charfunc_t func, const string_t *str);
  **/
 string_t *string_filter(boolfunc_t func, const string_t *str);
 
+/**
+ * Creates a new string by mapping every character of the input string
+ * through a translation table, for example to fold case. This is the
+ * table-driven and vectorized form of `string_map()`.
+ *
+ * @param str The input string.
+ * @param table The translation table; character c is replaced by
+ *        table[(unsigned char)c].
+ * @return A pointer to a newly allocated string of the translated
+ *         characters, or NULL if memory allocation failed. The returned
+ *         string must be deallocated using the standard C library function
+ *         `free()` when no longer needed.
+ **/
+string_t *string_map_table(const string_t *str, const char table[256]);
+
+/**
+ * Creates a new string containing only the characters of the input string
+ * that belong to a set. This is the table-driven and vectorized form of
+ * `string_filter()`.
+ *
+ * @param str The input string.
+ * @param set The set as a 256-bit mask; character c is kept if bit
+ *        (unsigned char)c % 64 of set[(unsigned char)c / 64] is set.
+ * @return A pointer to a newly allocated string of the kept characters,
+ *         or NULL if memory allocation failed. The returned string must be
+ *         deallocated using the standard C library function `free()` when
+ *         no longer needed.
+ **/
+string_t *string_filter_set(const string_t *str, const uint64_t set[4]);
+
 /**********************************************************************
  *                        String Vector                               *
  **********************************************************************/
@@ -361,6 +574,8 @@ typedef struct st_strvec {
   size_t cap;
   int top;
   string_t **buf;
+  string_arena_t *arena; /* owner of buf and the strings, or NULL */
+  struct string_vector_index *index; /* see string_vector_index() */
 } string_vector_t;
 
 /**
@@ -383,15 +598,33 @@ string_vector_t *string_split(const string_t *str, char delimiter);
  * This function takes a string `str` and a delimiter `delimiter`. It splits
  * the `str` into  multiple substrings using the `delimiter` as a separator.
  * The resulting substrings are stored in a dynamically allocated string vector,
- * which should be freed after use.
+ * which should be freed after use. Occurrences of the delimiter are found
+ * left to right without overlapping, in linear time.
  *
  * @param str The input string to be split.
- * @param delimiter The delimiter string used for splitting.
+ * @param delimiter The delimiter string used for splitting. An empty
+ *        delimiter yields the whole string as the only substring.
  * @return A dynamically allocated string vector containing the resulting
- *         substrings. It should be freed after use using
- *         `string_vector_deepfree()`.
+ *         substrings, or NULL if memory allocation failed. It should be freed
+ *         after use using `string_vector_deepfree()`.
+ **/
+string_vector_t *string_ssplit(const string_t *str, const string_t *delimiter);
+
+#define STRING_SPLIT_ALL SIZE_MAX
+
+/**
+ * Splits a string at no more than `max_splits` occurrences of a delimiter
+ * string. The last substring holds the rest of the input.
+ *
+ * @param str The input string to be split.
+ * @param delimiter The delimiter string used for splitting.
+ * @param max_splits The maximum number of splits, or `STRING_SPLIT_ALL`.
+ * @return A dynamically allocated string vector containing at most
+ *         `max_splits + 1` substrings, or NULL if memory allocation failed.
+ *         It should be freed after use using `string_vector_deepfree()`.
  **/
-string_vector_t *string_ssplit(const string_t *str, string_t *delimiter);
+string_vector_t *string_ssplit_n(const string_t *str, const string_t *delimiter,
+                                 size_t max_splits);
 
 /**
  * Creates an empty string_vector.
@@ -419,7 +652,8 @@ string_vector_t *string_vector_new(string_t *str);
  *
  * @param svec The string_vector_t object to be deallocated.
  * @note This function frees the memory of the vector itself, but NOT the
- *       memory of its elements.
+ *       memory of its elements. It does nothing for vectors allocated in an
+ *       arena.
  */
 
 void string_vector_free(string_vector_t *svec);
@@ -430,6 +664,7 @@ void string_vector_free(string_vector_t *svec);
  *
  * @param svec The string_vector to be deallocated.
  * @note This function frees the memory of the vector itself and its elements.
+ *       It does nothing for vectors allocated in an arena.
  **/
 void string_vector_deepfree(string_vector_t *svec);
 
@@ -450,9 +685,42 @@ void string_vector_add(string_vector_t *svec, string_t *str);
  * @param str The string to find.
  * @return The index of the first occurrence of the string in the vector,
  *         or -1 if not found.
+ * @note This function scans the vector, unless it has a hash index.
  **/
 int string_vector_find(const string_vector_t *svec, const string_t *str);
 
+/**
+ * Attaches a hash index to a string vector, which lets
+ * `string_vector_find()` take constant instead of linear time. The index
+ * is built right away and kept up to date by the functions that change
+ * the vector. The elements must not be changed through `buf` while the
+ * vector has an index. `string_vector_find()` only reads the index, so
+ * several threads may search an indexed vector at once, as long as none
+ * changes it.
+ *
+ * @param svec The string vector.
+ * @return true if the index is built, false if memory allocation failed.
+ *         `string_vector_find()` scans the vector in the latter case.
+ * @note The index is freed with the vector, or by
+ *       `string_vector_unindex()`.
+ **/
+bool string_vector_index(string_vector_t *svec);
+
+/**
+ * Removes the hash index of a string vector, if it has one.
+ *
+ * @param svec The string vector.
+ **/
+void string_vector_unindex(string_vector_t *svec);
+
+/**
+ * Returns the memory used by the hash index of a string vector.
+ *
+ * @param svec The string vector.
+ * @return The size of the index in bytes, or 0 if the vector has none.
+ **/
+size_t string_vector_index_bytes(const string_vector_t *svec);
+
 /**
  * Removes and returns the string at a specific index in a string_vector_t
  * object.
@@ -465,6 +733,188 @@ int string_vector_find(const string_vector_t *svec, const string_t *str);
  **/
 string_t *string_vector_remove(string_vector_t *svec, size_t index);
 
+/**
+ * Removes and returns the string at a specific index in constant time by
+ * moving the last string into its place. The order of the remaining
+ * strings is not preserved.
+ *
+ * @param svec The string vector.
+ * @param index The index of the string to remove.
+ * @return A pointer to the removed string, or NULL if the index is out of
+ *         bounds. The returned string must be deallocated using the standard
+ *         C library function `free()` when no longer needed.
+ **/
+string_t *string_vector_swap_remove(string_vector_t *svec, size_t index);
+
+/**
+ * Removes the strings at the indices [start, end) from a string vector and
+ * deallocates them, moving the later strings down once.
+ *
+ * @param svec The string vector.
+ * @param start The index of the first string to remove.
+ * @param end The index after the last string to remove. It is clamped to
+ *        the length of the vector.
+ * @return The number of strings removed.
+ * @note Strings of a vector allocated in an arena are not deallocated.
+ **/
+size_t string_vector_erase(string_vector_t *svec, size_t start, size_t end);
+
+/**
+ * Ensures that at least `n` more strings can be added to a string vector
+ * without another allocation.
+ *
+ * @param svec The string vector.
+ * @param n The number of strings to reserve space for.
+ * @return true on success, false if memory allocation failed.
+ **/
+bool string_vector_reserve(string_vector_t *svec, size_t n);
+
+/**
+ * Releases the unused capacity of a string vector.
+ *
+ * @param svec The string vector.
+ * @return true on success, false if memory allocation failed.
+ * @note It does nothing for vectors allocated in an arena.
+ **/
+bool string_vector_shrink_to_fit(string_vector_t *svec);
+
+/**
+ * Adds several strings to a string vector, growing it at most once.
+ *
+ * @param svec The string vector.
+ * @param strs The strings to add.
+ * @param n The number of strings in `strs`.
+ * @return true on success, false if memory allocation failed. The vector
+ *         is unchanged in the latter case.
+ * @note The vector takes ownership of the provided strings.
+ **/
+bool string_vector_extend(string_vector_t *svec, string_t *const *strs,
+                          size_t n);
+
+/**
+ * Sorts the strings of a string vector in the order of `string_compare()`.
+ * Equal strings may change their relative order.
+ *
+ * @param svec The string vector.
+ * @return true on success, false if memory allocation failed. The vector
+ *         is unchanged in the latter case.
+ **/
+bool string_vector_sort(string_vector_t *svec);
+
+/**
+ * Sorts the strings of a string vector like `string_vector_sort()`, but
+ * keeps equal strings in their relative order.
+ *
+ * @param svec The string vector.
+ * @return true on success, false if memory allocation failed. The vector
+ *         is unchanged in the latter case.
+ **/
+bool string_vector_sort_stable(string_vector_t *svec);
+
+/**
+ * Sorts the strings of a string vector like `string_vector_sort()` with
+ * several threads. Vectors too small to gain from threads are sorted by
+ * the calling thread alone.
+ *
+ * @param svec The string vector.
+ * @param threads The maximum number of threads, or 0 for the number of
+ *        online processors.
+ * @return true on success, false if memory allocation failed. The vector
+ *         is unchanged in the latter case.
+ **/
+bool string_vector_sort_parallel(string_vector_t *svec, size_t threads);
+
+/**
+ * Removes repeated strings from a string vector, keeping the first
+ * occurrence of each. Sorted vectors stay sorted and are deduplicated in
+ * one pass; others are deduplicated with a temporary hash table and keep
+ * their order. The removed strings are freed unless the vector belongs
+ * to an arena.
+ *
+ * @param svec The string vector.
+ * @return true on success, false if memory allocation failed. The vector
+ *         is unchanged in the latter case.
+ **/
+bool string_vector_unique(string_vector_t *svec);
+
+/**
+ * Computes the union of two string vectors, seen as sets of strings.
+ * If both vectors are sorted, they are merged and the result is sorted.
+ * Otherwise the result holds the distinct strings of a, then those of b
+ * that are not in a, each in the order of its first occurrence.
+ *
+ * @param a The first string vector.
+ * @param b The second string vector.
+ * @return A new string vector with copies of the strings, or NULL if
+ *         memory allocation failed.
+ **/
+string_vector_t *string_vector_union(const string_vector_t *a,
+                                     const string_vector_t *b);
+
+/**
+ * Computes the intersection of two string vectors, seen as sets of
+ * strings: the distinct strings of a that are also in b, in the order of
+ * a. If both vectors are sorted, they are merged without hashing.
+ *
+ * @param a The first string vector.
+ * @param b The second string vector.
+ * @return A new string vector with copies of the strings, or NULL if
+ *         memory allocation failed.
+ **/
+string_vector_t *string_vector_intersect(const string_vector_t *a,
+                                         const string_vector_t *b);
+
+/**
+ * Computes the difference of two string vectors, seen as sets of
+ * strings: the distinct strings of a that are not in b, in the order of
+ * a. If both vectors are sorted, they are merged without hashing.
+ *
+ * @param a The first string vector.
+ * @param b The second string vector.
+ * @return A new string vector with copies of the strings, or NULL if
+ *         memory allocation failed.
+ **/
+string_vector_t *string_vector_difference(const string_vector_t *a,
+                                          const string_vector_t *b);
+
+/**
+ * Replaces the strings of a by the union of a and b, like
+ * `string_vector_union()`. The strings added from b are copied.
+ *
+ * @param a The string vector to update.
+ * @param b The second string vector.
+ * @return true on success, false if memory allocation failed. The vector
+ *         is unchanged in the latter case.
+ **/
+bool string_vector_union_inplace(string_vector_t *a,
+                                 const string_vector_t *b);
+
+/**
+ * Keeps the distinct strings of a that are also in b, like
+ * `string_vector_intersect()`, and frees the others unless a belongs to
+ * an arena.
+ *
+ * @param a The string vector to update.
+ * @param b The second string vector.
+ * @return true on success, false if memory allocation failed. The vector
+ *         is unchanged in the latter case.
+ **/
+bool string_vector_intersect_inplace(string_vector_t *a,
+                                     const string_vector_t *b);
+
+/**
+ * Keeps the distinct strings of a that are not in b, like
+ * `string_vector_difference()`, and frees the others unless a belongs to
+ * an arena.
+ *
+ * @param a The string vector to update.
+ * @param b The second string vector.
+ * @return true on success, false if memory allocation failed. The vector
+ *         is unchanged in the latter case.
+ **/
+bool string_vector_difference_inplace(string_vector_t *a,
+                                      const string_vector_t *b);
+
 /**
  * Compares two string_vector objects for equality.
  *
@@ -550,6 +1000,18 @@ string_vector_t *string_vector_filter(strboolfunc_t func,
 string_vector_t *string_vector_filter(strboolfunc_t func,
                                       const string_vector_t *svec);
 
+/**
+ * Removes the strings for which a predicate returns true from a string
+ * vector and deallocates them, in a single pass that keeps the order of
+ * the remaining strings.
+ *
+ * @param svec The string vector.
+ * @param func The predicate, called once for each string.
+ * @return The number of strings removed.
+ * @note Strings of a vector allocated in an arena are not deallocated.
+ **/
+size_t string_vector_remove_if(string_vector_t *svec, strboolfunc_t func);
+
 /**
  * Reduces the string vector to a single string using a reduction function.
  *
@@ -573,6 +1035,1101 @@ string_vector_t *string_vector_filter(strboolfunc_t func,
 string_t *string_vector_reduce(reducefunc_t func, const string_vector_t *svec,
                                string_t *initializer);
 
+/**
+ * Applies a function to each string in a string vector like
+ * `string_vector_map()`, with several threads. The threads take chunks of
+ * the vector and steal chunks from each other when they run out, so
+ * strings that take longer to map do not leave threads idle.
+ *
+ * @param func The function to apply to each string in the vector. It is
+ *        called from several threads at once.
+ * @param svec The string vector.
+ * @param threads The maximum number of threads, or 0 for the number of
+ *        online processors.
+ * @return A pointer to a newly allocated string vector containing the
+ *         results in the order of `svec`, or NULL if memory allocation
+ *         failed. The returned vector must be deallocated using
+ *         `string_vector_deepfree()`.
+ **/
+string_vector_t *string_vector_map_parallel(strfunc_t func,
+                                            const string_vector_t *svec,
+                                            size_t threads);
+
+/**
+ * Filters the strings in a string vector like `string_vector_filter()`,
+ * with several threads. The strings that satisfy the filtering function
+ * keep their order.
+ *
+ * @param func The filtering function. It is called from several threads
+ *        at once.
+ * @param svec The string vector.
+ * @param threads The maximum number of threads, or 0 for the number of
+ *        online processors.
+ * @return A pointer to a newly allocated string vector containing copies
+ *         of the strings that satisfy the filtering function, or NULL if
+ *         memory allocation failed. The returned vector must be
+ *         deallocated using `string_vector_deepfree()`.
+ **/
+string_vector_t *string_vector_filter_parallel(strboolfunc_t func,
+                                               const string_vector_t *svec,
+                                               size_t threads);
+
+/**
+ * Reduces a string vector to a single string like
+ * `string_vector_reduce()`, with several threads. Each thread reduces
+ * chunks of the vector, and the partial results are combined in a tree
+ * by calling `func` on two of them. The result equals the one of
+ * `string_vector_reduce()` if `func` is associative, such as
+ * concatenation.
+ *
+ * @param func The associative reduction function. It is called from
+ *        several threads at once.
+ * @param svec The input string vector.
+ * @param initializer The initial accumulator value (can be NULL for an
+ *        empty string).
+ * @param threads The maximum number of threads, or 0 for the number of
+ *        online processors.
+ * @return A dynamically allocated string that must be deallocated using
+ *         `free()`, or NULL if memory allocation failed.
+ **/
+string_t *string_vector_reduce_parallel(reducefunc_t func,
+                                        const string_vector_t *svec,
+                                        string_t *initializer,
+                                        size_t threads);
+
+/**********************************************************************
+ *                          String View                               *
+ **********************************************************************/
+
+/*
+ * A string view borrows `len` bytes starting at `buf` from a string that is
+ * owned by someone else. Views are passed by value and never freed; they
+ * are valid as long as the string they point into.
+ */
+typedef struct {
+  size_t len;
+  const char *buf;
+} string_view_t;
+
+typedef struct {
+  size_t cap;
+  int top;
+  string_view_t *buf;
+} string_view_vector_t;
+
+/**
+ * Returns a view of the whole string.
+ *
+ * @param str The string to view.
+ * @return A view of all bytes of `str`.
+ **/
+static inline string_view_t string_view(const string_t *str) {
+  return (string_view_t){str->len, str->buf};
+}
+
+/**
+ * Returns a view of the bytes [start, end) of a view.
+ *
+ * @param v The input view.
+ * @param start The starting index of the substring.
+ * @param end The index one past the last byte of the substring.
+ * @return A view of the substring, or an empty view with a NULL buffer if
+ *         the indices are out of bounds.
+ **/
+string_view_t string_view_substring(string_view_t v, size_t start, size_t end);
+
+/**
+ * Returns a view without the leading and trailing whitespace of a view.
+ *
+ * @param v The input view.
+ * @return The trimmed view.
+ **/
+string_view_t string_view_trim(string_view_t v);
+
+/**
+ * Copies the bytes of a view into a newly allocated string.
+ *
+ * @param v The view to materialize.
+ * @return A pointer to a newly allocated string, or NULL if memory
+ *         allocation failed. The returned string must be deallocated using
+ *         the standard C library function `free()` when no longer needed.
+ **/
+string_t *string_view_tostring(string_view_t v);
+
+/**
+ * Compares two views lexicographically.
+ *
+ * @param a The first view to compare.
+ * @param b The second view to compare.
+ * @return An integer greater than, equal to, or less than 0 if a is greater
+ *         than, equal to, or less than b, respectively.
+ **/
+int string_view_compare(string_view_t a, string_view_t b);
+
+/**
+ * Checks if two views have equal contents.
+ *
+ * @param a The first view to compare.
+ * @param b The second view to compare.
+ * @return True if the contents of a are equal to the contents of b, false
+ *         otherwise.
+ **/
+bool string_view_equal(string_view_t a, string_view_t b);
+
+/**
+ * Computes the hash of a view, which is the same as `string_hash()` of a
+ * string with the same contents.
+ *
+ * @param v The view to hash.
+ * @param seed The seed, as for `string_hash()`.
+ * @return The hash of the view.
+ **/
+uint64_t string_view_hash(string_view_t v, uint64_t seed);
+
+/**
+ * Finds the first occurrence of a substring within a view.
+ *
+ * @param str The view to search in.
+ * @param sub The substring to search for.
+ * @return The index of the first occurrence of the substring in the view,
+ *         or -1 if not found.
+ **/
+int string_view_index(string_view_t str, string_view_t sub);
+
+/**
+ * Splits a view into multiple views based on a delimiter character.
+ *
+ * @param v The view to split.
+ * @param delimiter The delimiter character used for splitting.
+ * @return A pointer to a newly allocated view vector, or NULL if memory
+ *         allocation failed. The returned vector must be deallocated using
+ *         `string_view_vector_free()`. Its views point into `v`.
+ **/
+string_view_vector_t *string_view_split(string_view_t v, char delimiter);
+
+/**
+ * Splits a view into multiple views based on a delimiter string.
+ *
+ * @param v The view to split.
+ * @param delimiter The delimiter string used for splitting.
+ * @return A pointer to a newly allocated view vector, or NULL if memory
+ *         allocation failed. The returned vector must be deallocated using
+ *         `string_view_vector_free()`. Its views point into `v`.
+ **/
+string_view_vector_t *string_view_ssplit(string_view_t v,
+                                         string_view_t delimiter);
+
+/*
+ * A split iterator yields the fields of a view one at a time, without
+ * building a vector. It finds delimiters 64 bytes at a time with SIMD
+ * comparisons. Its members are private.
+ */
+typedef struct {
+  const char *buf;
+  size_t len;
+  size_t start;  /* offset of the next field */
+  size_t block;  /* offset of the 64 byte block covered by mask */
+  uint64_t mask; /* delimiters in the block not yet yielded */
+  char delimiter;
+  bool done;
+} string_split_iter_t;
+
+/**
+ * Creates an iterator over the fields of a view separated by a delimiter
+ * character. It yields the same fields as `string_view_split()`.
+ *
+ * @param v The view to split.
+ * @param delimiter The delimiter character.
+ * @return The iterator.
+ **/
+string_split_iter_t string_split_iter(string_view_t v, char delimiter);
+
+/**
+ * Advances a split iterator to the next field.
+ *
+ * @param it The iterator.
+ * @param field Receives the next field, which points into the view.
+ * @return true if a field was yielded, false after the last field.
+ **/
+bool string_split_next(string_split_iter_t *it, string_view_t *field);
+
+/*
+ * A delimiter string split iterator yields the fields of a view separated
+ * by a compiled needle. Its members are private.
+ */
+typedef struct {
+  const char *buf;
+  size_t len;
+  size_t start;  /* offset of the next field */
+  size_t splits; /* number of splits left */
+  const string_needle_t *delimiter;
+  bool done;
+} string_ssplit_iter_t;
+
+/**
+ * Creates an iterator over the fields of a view separated by a delimiter
+ * string. It yields the same fields as `string_ssplit_n()`.
+ *
+ * @param v The view to split.
+ * @param delimiter The compiled delimiter, which must outlive the
+ *        iterator.
+ * @param max_splits The maximum number of splits, or `STRING_SPLIT_ALL`.
+ * @return The iterator.
+ **/
+string_ssplit_iter_t string_ssplit_iter(string_view_t v,
+                                        const string_needle_t *delimiter,
+                                        size_t max_splits);
+
+/**
+ * Advances a delimiter string split iterator to the next field.
+ *
+ * @param it The iterator.
+ * @param field Receives the next field, which points into the view.
+ * @return true if a field was yielded, false after the last field.
+ **/
+bool string_ssplit_next(string_ssplit_iter_t *it, string_view_t *field);
+
+/**
+ * Creates an empty view vector.
+ *
+ * @return A pointer to a newly allocated empty view vector, or NULL if
+ *         memory allocation failed. The returned vector must be deallocated
+ *         using `string_view_vector_free()`.
+ **/
+string_view_vector_t *string_view_vector_empty();
+
+/**
+ * Deallocates memory associated with a view vector. The strings its views
+ * point into are not affected.
+ *
+ * @param vvec The view vector to be deallocated.
+ **/
+void string_view_vector_free(string_view_vector_t *vvec);
+
+/**
+ * Adds a view to a view vector.
+ *
+ * @param vvec The view vector.
+ * @param v The view to add.
+ * @return true on success, false if memory allocation failed.
+ **/
+bool string_view_vector_add(string_view_vector_t *vvec, string_view_t v);
+
+/**
+ * Returns the number of views currently stored in a view vector.
+ *
+ * @param vvec The view vector to query.
+ * @return The number of views in the vector.
+ */
+static inline size_t string_view_vector_len(const string_view_vector_t *vvec) {
+  return (size_t)(vvec->top + 1);
+}
+
+/**
+ * Retrieves the view at the specified index from a view vector.
+ *
+ * @param vvec The view vector.
+ * @param index The index of the view to retrieve.
+ * @return The view at the specified index, or an empty view with a NULL
+ *         buffer if the index is out of bounds.
+ */
+static inline string_view_t string_view_vector_get(
+    const string_view_vector_t *vvec, size_t index) {
+  return (index < string_view_vector_len(vvec)) ? vvec->buf[index]
+                                                 : (string_view_t){0, NULL};
+}
+
+/**********************************************************************
+ *                        Flat String Vector                          *
+ **********************************************************************/
+
+/*
+ * A flat vector stores the contents of all its strings back to back in
+ * one buffer and their boundaries in an array of offsets, like the string
+ * columns of Apache Arrow. Iterating over it reads memory sequentially,
+ * and it is freed with a constant number of calls to free(). Its strings
+ * are read as views into the buffer, which are valid until the vector is
+ * changed or freed.
+ */
+
+typedef struct {
+  size_t len;       /* number of strings */
+  size_t cap;       /* number of strings offsets has room for */
+  size_t *offsets;  /* string i is bytes[offsets[i], offsets[i + 1]) */
+  char *bytes;      /* the contents of the strings */
+  size_t bytes_cap; /* size of bytes */
+} string_flatvec_t;
+
+/**
+ * Creates an empty flat vector.
+ *
+ * @return A pointer to a newly allocated empty flat vector, or NULL if
+ *         memory allocation failed. The returned vector must be deallocated
+ *         using `string_flatvec_free()`.
+ **/
+string_flatvec_t *string_flatvec_empty();
+
+/**
+ * Deallocates a flat vector and the contents of its strings.
+ *
+ * @param fvec The flat vector to be deallocated.
+ **/
+void string_flatvec_free(string_flatvec_t *fvec);
+
+/**
+ * Appends a copy of a string to a flat vector.
+ *
+ * @param fvec The flat vector.
+ * @param str The string to append.
+ * @return true on success, false if memory allocation failed.
+ **/
+bool string_flatvec_add(string_flatvec_t *fvec, const string_t *str);
+
+/**
+ * Appends a copy of the contents of a view to a flat vector.
+ *
+ * @param fvec The flat vector.
+ * @param v The view to append. It must not point into `fvec`.
+ * @return true on success, false if memory allocation failed.
+ **/
+bool string_flatvec_add_view(string_flatvec_t *fvec, string_view_t v);
+
+/**
+ * Returns the number of strings in a flat vector.
+ *
+ * @param fvec The flat vector to query.
+ * @return The number of strings in the vector.
+ */
+static inline size_t string_flatvec_len(const string_flatvec_t *fvec) {
+  return fvec->len;
+}
+
+/**
+ * Retrieves the string at the specified index from a flat vector.
+ *
+ * @param fvec The flat vector.
+ * @param index The index of the string to retrieve.
+ * @return A view of the string, or an empty view with a NULL buffer if the
+ *         index is out of bounds.
+ */
+static inline string_view_t string_flatvec_get(const string_flatvec_t *fvec,
+                                               size_t index) {
+  if (index >= fvec->len)
+    return (string_view_t){0, NULL};
+  return (string_view_t){fvec->offsets[index + 1] - fvec->offsets[index],
+                         fvec->bytes + fvec->offsets[index]};
+}
+
+/**
+ * Finds the index of a string in a flat vector.
+ *
+ * @param fvec The flat vector.
+ * @param str The string to find.
+ * @return The index of the first occurrence of the string in the vector,
+ *         or -1 if not found.
+ **/
+int string_flatvec_find(const string_flatvec_t *fvec, const string_t *str);
+
+/**
+ * Sorts the strings of a flat vector in the order of `string_compare()`.
+ *
+ * @param fvec The flat vector.
+ * @return true on success, false if memory allocation failed. The vector
+ *         is unchanged in the latter case.
+ **/
+bool string_flatvec_sort(string_flatvec_t *fvec);
+
+/**
+ * Copies the strings of a flat vector into a string vector.
+ *
+ * @param fvec The flat vector.
+ * @return A pointer to a newly allocated string vector, or NULL if memory
+ *         allocation failed. The returned vector must be deallocated using
+ *         `string_vector_deepfree()`.
+ **/
+string_vector_t *string_flatvec_tovector(const string_flatvec_t *fvec);
+
+/**
+ * Copies the strings of a string vector into a flat vector.
+ *
+ * @param svec The string vector.
+ * @return A pointer to a newly allocated flat vector, or NULL if memory
+ *         allocation failed. The returned vector must be deallocated using
+ *         `string_flatvec_free()`.
+ **/
+string_flatvec_t *string_flatvec_from_vector(const string_vector_t *svec);
+
+/**
+ * Splits a string at a delimiter character into a flat vector, like
+ * `string_split()`, with two memory allocations in total.
+ *
+ * @param str The string to split.
+ * @param delimiter The delimiter character used for splitting.
+ * @return A pointer to a newly allocated flat vector of the substrings,
+ *         or NULL if memory allocation failed. The returned vector must be
+ *         deallocated using `string_flatvec_free()`.
+ **/
+string_flatvec_t *string_split_flat(const string_t *str, char delimiter);
+
+/**********************************************************************
+ *                            String Map                              *
+ **********************************************************************/
+
+/*
+ * A hash map from strings to pointers. The map copies its keys; the values
+ * are not owned by the map. The copies of erased keys are reclaimed once
+ * they take more memory than the copies of the keys present.
+ * Lookups cost a hash of the key and usually one probe, independent of the
+ * number of keys.
+ */
+
+typedef struct string_map string_map_t;
+
+/**
+ * Creates an empty map.
+ *
+ * @param cap The number of keys to reserve space for, or 0.
+ * @return A pointer to the new map, or NULL if memory allocation failed.
+ *         The returned map must be deallocated using `string_map_free()`.
+ **/
+string_map_t *string_map_new(size_t cap);
+
+/**
+ * Deallocates a map and its copies of the keys, but not the values.
+ *
+ * @param map The map to be deallocated.
+ **/
+void string_map_free(string_map_t *map);
+
+/**
+ * Returns the number of keys in a map.
+ *
+ * @param map The map.
+ * @return The number of keys.
+ **/
+size_t string_map_len(const string_map_t *map);
+
+/**
+ * Inserts a key with a value into a map, or replaces the value if the key
+ * is already present.
+ *
+ * @param map The map.
+ * @param key The key. The map stores a copy of it.
+ * @param value The value.
+ * @return True on success, false if memory allocation failed. The map is
+ *         unchanged in the latter case.
+ **/
+bool string_map_insert(string_map_t *map, const string_t *key, void *value);
+
+/**
+ * Looks up a key in a map.
+ *
+ * @param map The map.
+ * @param key The key to look up.
+ * @return A pointer to the value of the key, which may be used to replace
+ *         the value, or NULL if the key is not present. The pointer is
+ *         valid until the next insertion into or erasure from the map.
+ **/
+void **string_map_find(const string_map_t *map, const string_t *key);
+
+/**
+ * Looks up the contents of a view in a map, like `string_map_find()`.
+ *
+ * @param map The map.
+ * @param key The key to look up.
+ * @return A pointer to the value of the key, or NULL if the key is not
+ *         present.
+ **/
+void **string_map_find_view(const string_map_t *map, string_view_t key);
+
+/**
+ * Removes a key and its value from a map.
+ *
+ * @param map The map.
+ * @param key The key to remove.
+ * @return True if the key was present, false otherwise.
+ **/
+bool string_map_erase(string_map_t *map, const string_t *key);
+
+/**
+ * Iterates over the keys and values of a map in no particular order. The
+ * map must not be changed during the iteration, except for replacing
+ * values.
+ *
+ * @param map The map.
+ * @param pos The position of the iteration, to be set to 0 before the
+ *        first call.
+ * @param key Receives the next key, which is owned by the map and valid
+ *        until the next insertion.
+ * @param value Receives the value of the next key.
+ * @return True if a key was returned, false at the end of the map.
+ **/
+bool string_map_next(const string_map_t *map, size_t *pos,
+                     const string_t **key, void **value);
+
+/**********************************************************************
+ *                         String Interning                           *
+ **********************************************************************/
+
+/*
+ * An intern table stores one copy of every distinct string it is given
+ * and hands out that copy each time, so that interned strings are equal
+ * exactly if their pointers are. The copies stay valid until the table is
+ * freed. A table may be used by several threads at once: lookups of
+ * strings that are already interned take no lock, and insertions lock
+ * only one of several shards.
+ */
+
+typedef struct string_intern string_intern_t;
+
+/**
+ * Creates an empty intern table.
+ *
+ * @return A pointer to the new table, or NULL if memory allocation failed.
+ *         The returned table must be deallocated using
+ *         `string_intern_free()`.
+ **/
+string_intern_t *string_intern_new(void);
+
+/**
+ * Deallocates an intern table and all strings interned in it. No other
+ * thread may use the table at the same time.
+ *
+ * @param intern The table to be deallocated.
+ **/
+void string_intern_free(string_intern_t *intern);
+
+/**
+ * Returns the number of distinct strings in an intern table.
+ *
+ * @param intern The table.
+ * @return The number of strings.
+ **/
+size_t string_intern_len(const string_intern_t *intern);
+
+/**
+ * Interns a string.
+ *
+ * @param intern The table.
+ * @param str The string to intern.
+ * @return The copy of `str` owned by the table, the same pointer for all
+ *         equal strings, or NULL if memory allocation failed. It must not
+ *         be freed and is valid until the table is freed.
+ **/
+const string_t *string_intern(string_intern_t *intern, const string_t *str);
+
+/**
+ * Interns the contents of a view, like `string_intern()`.
+ *
+ * @param intern The table.
+ * @param v The view to intern.
+ * @return The interned copy of the contents of `v`, or NULL if memory
+ *         allocation failed.
+ **/
+const string_t *string_intern_view(string_intern_t *intern, string_view_t v);
+
+/**
+ * Looks up the contents of a view in an intern table without interning
+ * them.
+ *
+ * @param intern The table.
+ * @param v The view to look up.
+ * @return The interned copy of the contents of `v`, or NULL if they have
+ *         not been interned.
+ **/
+const string_t *string_intern_find(const string_intern_t *intern,
+                                   string_view_t v);
+
+/**********************************************************************
+ *                          String Builder                            *
+ **********************************************************************/
+
+/*
+ * A string builder is a mutable buffer for assembling a string from many
+ * pieces. Its capacity grows geometrically, so n appends take amortized
+ * O(n) time, whereas chaining string_concat() copies the whole prefix on
+ * every call. The append functions return false if memory allocation
+ * failed, in which case the builder is left unchanged.
+ */
+
+typedef struct string_builder string_builder_t;
+
+/**
+ * Creates an empty string builder.
+ *
+ * @param capacity The number of bytes to reserve, or 0 for a small
+ *        default.
+ * @return A pointer to the newly allocated builder, or NULL if memory
+ *         allocation failed. The builder must be consumed with
+ *         `string_builder_finish()` or deallocated with
+ *         `string_builder_free()`.
+ **/
+string_builder_t *string_builder_new(size_t capacity);
+
+/**
+ * Deallocates a string builder and its contents.
+ *
+ * @param sb The builder to be deallocated.
+ **/
+void string_builder_free(string_builder_t *sb);
+
+/**
+ * Ensures that at least `n` more bytes can be appended without another
+ * allocation.
+ *
+ * @param sb The builder.
+ * @param n The number of bytes to reserve.
+ * @return true on success, false if memory allocation failed.
+ **/
+bool string_builder_reserve(string_builder_t *sb, size_t n);
+
+/**
+ * Appends a string.
+ *
+ * @param sb The builder.
+ * @param str The string to append.
+ * @return true on success, false if memory allocation failed.
+ **/
+bool string_builder_append(string_builder_t *sb, const string_t *str);
+
+/**
+ * Appends a null-terminated C string.
+ *
+ * @param sb The builder.
+ * @param cstr The C string to append.
+ * @return true on success, false if memory allocation failed.
+ **/
+bool string_builder_append_cstr(string_builder_t *sb, const char *cstr);
+
+/**
+ * Appends a single character.
+ *
+ * @param sb The builder.
+ * @param c The character to append.
+ * @return true on success, false if memory allocation failed.
+ **/
+bool string_builder_append_char(string_builder_t *sb, char c);
+
+/**
+ * Appends the decimal representation of an integer.
+ *
+ * @param sb The builder.
+ * @param value The integer to append.
+ * @return true on success, false if memory allocation failed.
+ **/
+bool string_builder_append_int(string_builder_t *sb, long long value);
+
+/**
+ * Appends text formatted as by printf().
+ *
+ * @param sb The builder.
+ * @param fmt The printf() format string.
+ * @return true on success, false if memory allocation failed or `fmt` is
+ *         invalid.
+ **/
+bool string_builder_append_format(string_builder_t *sb, const char *fmt, ...)
+    __attribute__((format(printf, 2, 3)));
+
+/**
+ * Returns the number of bytes appended to a string builder so far.
+ *
+ * @param sb The builder.
+ * @return The length of the contents.
+ **/
+size_t string_builder_len(const string_builder_t *sb);
+
+/**
+ * Returns a view of the contents of a string builder. The view is valid
+ * until the next append to or reserve on the builder.
+ *
+ * @param sb The builder.
+ * @return A view of the contents.
+ **/
+string_view_t string_builder_view(const string_builder_t *sb);
+
+/**
+ * Consumes a string builder and returns its contents as a string. The
+ * buffer is shrunk in place rather than copied. The builder must not be
+ * used afterwards.
+ *
+ * @param sb The builder.
+ * @return A pointer to the resulting string. The returned string must be
+ *         deallocated using the standard C library function `free()` when
+ *         no longer needed.
+ **/
+string_t *string_builder_finish(string_builder_t *sb);
+
+/**********************************************************************
+ *                        Memory-Mapped Files                         *
+ **********************************************************************/
+
+/*
+ * A memory-mapped file is a read-only string backed by the page cache, so
+ * large files can be searched, split and compared without being copied to
+ * the heap. It can be passed to every function that takes a
+ * `const string_t *`, and `string_view()` turns it into a view. Functions
+ * that return an `int` offset cannot address beyond 2 GB; use the needle
+ * or view functions for larger files. Truncating the file while it is
+ * mapped makes accesses beyond the new end fail with SIGBUS.
+ */
+
+enum string_mmap_flags {
+  STRING_MMAP_SEQUENTIAL = 1, /* madvise(MADV_SEQUENTIAL) */
+  STRING_MMAP_RANDOM = 2,     /* madvise(MADV_RANDOM) */
+  STRING_MMAP_WILLNEED = 4,   /* madvise(MADV_WILLNEED) */
+};
+
+/**
+ * Maps a regular file into memory as a read-only string.
+ *
+ * @param path The path of the file.
+ * @param flags A combination of `enum string_mmap_flags` describing how
+ *        the file will be accessed, or 0.
+ * @return A pointer to the mapped string, or NULL with errno set if the
+ *         file could not be opened or mapped or is not a regular file. The
+ *         returned string must be released using `string_munmap()`.
+ **/
+const string_t *string_mmap_file(const char *path, int flags);
+
+/**
+ * Unmaps a string returned by `string_mmap_file()`. Views into the string
+ * become invalid.
+ *
+ * @param str The mapped string.
+ **/
+void string_munmap(const string_t *str);
+
+/**********************************************************************
+ *                            Line Reader                             *
+ **********************************************************************/
+
+/*
+ * A line reader reads a file descriptor through a large buffer and yields
+ * its lines as views into that buffer, so iterating over lines allocates
+ * nothing per line. The buffer grows to hold lines longer than itself.
+ */
+
+typedef struct string_line_reader string_line_reader_t;
+
+enum string_line_ending {
+  STRING_EOL_NONE, /* last line of the input without a newline */
+  STRING_EOL_LF,   /* "\n" */
+  STRING_EOL_CRLF, /* "\r\n" */
+};
+
+/**
+ * Creates a line reader over a file descriptor. The reader does not take
+ * ownership of the file descriptor.
+ *
+ * @param fd The file descriptor to read from.
+ * @param buffer_size The initial size of the buffer, or 0 for the default
+ *        of 256 KB.
+ * @return A pointer to the newly allocated line reader, or NULL if memory
+ *         allocation failed. The returned reader must be deallocated using
+ *         `string_line_reader_free()`.
+ **/
+string_line_reader_t *string_line_reader_new(int fd, size_t buffer_size);
+
+/**
+ * Deallocates a line reader.
+ *
+ * @param reader The line reader to be deallocated.
+ **/
+void string_line_reader_free(string_line_reader_t *reader);
+
+/**
+ * Reads the next line.
+ *
+ * @param reader The line reader.
+ * @param line Receives the line without its line ending. The view is valid
+ *        until the next call on the reader.
+ * @param ending Receives the line ending of the line, or NULL.
+ * @return true if a line was read, false at the end of the input or if an
+ *         error occurred (see `string_line_reader_error()`).
+ **/
+bool string_line_reader_next(string_line_reader_t *reader, string_view_t *line,
+                             enum string_line_ending *ending);
+
+/**
+ * Returns the error that stopped a line reader.
+ *
+ * @param reader The line reader.
+ * @return The errno value of the failed read() or memory allocation, or 0
+ *         if no error occurred.
+ **/
+int string_line_reader_error(const string_line_reader_t *reader);
+
+/**********************************************************************
+ *                              Arena                                 *
+ **********************************************************************/
+
+/*
+ * An arena allocates from large chunks by bumping a pointer. Objects
+ * allocated in an arena are never freed individually; they are all
+ * released at once by string_arena_reset() or string_arena_free(). Every
+ * string_arena_*() variant below takes an arena as its first argument and
+ * otherwise behaves like the function of the same name without "arena_".
+ * Passing NULL as the arena allocates the result on the heap instead.
+ */
+
+/**
+ * Creates an empty arena.
+ *
+ * @param chunk_size The size of the chunks the arena allocates from, or 0
+ *        for the default of 64 KB.
+ * @return A pointer to the newly allocated arena, or NULL if memory
+ *         allocation failed. The returned arena must be deallocated using
+ *         `string_arena_free()`.
+ **/
+string_arena_t *string_arena_create(size_t chunk_size);
+
+/**
+ * Allocates memory from an arena.
+ *
+ * @param arena The arena.
+ * @param size The number of bytes to allocate.
+ * @return A pointer to `size` bytes aligned to 16 bytes, or NULL if memory
+ *         allocation failed. The memory is valid until the arena is reset
+ *         or freed.
+ **/
+void *string_arena_alloc(string_arena_t *arena, size_t size);
+
+/**
+ * Releases everything allocated from an arena in constant time. The
+ * arena keeps its chunks and reuses them for later allocations.
+ *
+ * @param arena The arena.
+ **/
+void string_arena_reset(string_arena_t *arena);
+
+/**
+ * Deallocates an arena and everything allocated from it.
+ *
+ * @param arena The arena to be deallocated.
+ **/
+void string_arena_free(string_arena_t *arena);
+
+string_t *string_arena_nnew(string_arena_t *arena, const char *str,
+                            size_t len);
+string_t *string_arena_new(string_arena_t *arena, const char *str);
+string_t *string_arena_clone(string_arena_t *arena, const string_t *str);
+string_t *string_arena_concat(string_arena_t *arena, const string_t *s1,
+                              const string_t *s2);
+string_t *string_arena_trim(string_arena_t *arena, const string_t *str);
+string_t *string_arena_substring(string_arena_t *arena, const string_t *str,
+                                 size_t start, size_t end);
+string_vector_t *string_arena_split(string_arena_t *arena, const string_t *str,
+                                    char delimiter);
+
+/**
+ * Creates an empty string vector in an arena. The vector grows within the
+ * arena when strings are added with `string_vector_add()`.
+ *
+ * @param arena The arena.
+ * @return A pointer to the new empty vector, or NULL if memory allocation
+ *         failed.
+ **/
+string_vector_t *string_arena_vector_empty(string_arena_t *arena);
+
+/**********************************************************************
+ *                            Allocator                               *
+ **********************************************************************/
+
+/*
+ * All heap memory of libstring is allocated, resized and released through
+ * one allocator, which defaults to malloc(), realloc() and free(). The
+ * allocator must be installed before libstring allocates anything and must
+ * not be changed while objects allocated by libstring are still alive.
+ * Wherever this header says that an object must be deallocated using
+ * `free()`, use `libstring_free()` instead once a custom allocator is
+ * installed.
+ */
+
+typedef struct {
+  void *(*malloc_fn)(void *ctx, size_t size);
+  void *(*realloc_fn)(void *ctx, void *ptr, size_t size);
+  void (*free_fn)(void *ctx, void *ptr);
+  void *ctx; /* passed to every call of the functions above */
+} libstring_allocator_t;
+
+/**
+ * Installs the allocator used for all heap memory of libstring. The
+ * allocator is copied; the memory `ctx` points to must outlive its use.
+ * This function is not thread-safe.
+ *
+ * @param allocator The allocator, or NULL for malloc(), realloc() and
+ *        free().
+ **/
+void libstring_set_allocator(const libstring_allocator_t *allocator);
+
+/**
+ * Deallocates an object allocated on the heap by libstring, using the
+ * installed allocator.
+ *
+ * @param ptr The object to be deallocated, or NULL.
+ **/
+void libstring_free(void *ptr);
+
+/**
+ * Returns an allocator that forwards to `backing` and counts the memory
+ * libstring holds. While it is installed, `libstring_alloc_stats()` and
+ * `libstring_alloc_counts()` report the counters. The counters are global
+ * and updated atomically.
+ *
+ * @param backing The allocator to forward to, or NULL for malloc(),
+ *        realloc() and free(). It must outlive the returned allocator.
+ * @return The counting allocator, to be installed with
+ *         `libstring_set_allocator()`.
+ **/
+libstring_allocator_t
+libstring_counting_allocator(const libstring_allocator_t *backing);
+
+typedef struct {
+  size_t live_bytes; /* bytes currently allocated */
+  size_t peak_bytes; /* maximum of live_bytes so far */
+  size_t allocs;     /* number of successful allocations and resizes */
+  size_t frees;      /* number of deallocations */
+} libstring_alloc_stats_t;
+
+typedef struct {
+  const char *function; /* the libstring function that allocated */
+  size_t allocs;        /* number of successful allocations and resizes */
+  size_t bytes;         /* total number of bytes requested */
+} libstring_alloc_count_t;
+
+/**
+ * Reads the counters of the counting allocator.
+ *
+ * @param stats Receives the counters.
+ * @return true if the counting allocator is installed, false otherwise.
+ **/
+bool libstring_alloc_stats(libstring_alloc_stats_t *stats);
+
+/**
+ * Reads the allocation counters of every libstring function that has
+ * allocated memory while the counting allocator was installed. Memory
+ * allocated inside an arena is counted once per chunk, under
+ * "string_arena_alloc". Counters are kept for up to 256 functions, more
+ * than libstring has; beyond that, allocations are counted under
+ * "(other)".
+ *
+ * @param counts Receives up to `n` counters.
+ * @param n The capacity of `counts`.
+ * @return The number of functions with counters, which may exceed `n`.
+ **/
+size_t libstring_alloc_counts(libstring_alloc_count_t *counts, size_t n);
+
+/**********************************************************************
+ *                         Instruction Sets                           *
+ **********************************************************************/
+
+/*
+ * Character scanning, trimming, splitting and substring search use SIMD
+ * code paths selected at run time from the instruction sets of the CPU.
+ */
+
+enum libstring_isa {
+  LIBSTRING_ISA_SCALAR, /* portable C */
+  LIBSTRING_ISA_SSE2,   /* 16-byte vectors */
+  LIBSTRING_ISA_AVX2,   /* 32-byte vectors */
+  LIBSTRING_ISA_AVX512  /* 64-byte vectors with AVX-512BW, and VBMI if
+                           available */
+};
+
+/**
+ * Returns the instruction set level libstring currently uses.
+ *
+ * @return The level in use.
+ **/
+enum libstring_isa libstring_isa(void);
+
+/**
+ * Limits the instruction set level libstring uses, for example to compare
+ * the code paths. Levels above the one the CPU supports are lowered to
+ * it. This function is not thread-safe.
+ *
+ * @param max The highest level to use.
+ * @return The level now in use.
+ **/
+enum libstring_isa libstring_set_isa(enum libstring_isa max);
+
+/**********************************************************************
+ *                      Multi-Pattern Search                          *
+ **********************************************************************/
+
+typedef struct string_matcher string_matcher_t;
+
+typedef struct {
+  size_t pattern; /* index of the matching pattern */
+  size_t offset;  /* offset of the match in the searched string */
+} string_match_t;
+
+/**
+ * Builds an Aho-Corasick automaton that finds all patterns of a string
+ * vector in a single pass over the searched string.
+ *
+ * @param patterns The patterns to search for. Empty patterns never match.
+ * @return A pointer to the newly allocated matcher, or NULL if memory
+ *         allocation failed. The returned matcher must be deallocated using
+ *         `string_matcher_free()`.
+ * @note The matcher keeps no reference to `patterns`.
+ **/
+string_matcher_t *string_matcher_new(const string_vector_t *patterns);
+
+/**
+ * Deallocates memory associated with a matcher.
+ *
+ * @param mt The matcher to be deallocated.
+ **/
+void string_matcher_free(string_matcher_t *mt);
+
+/**
+ * Checks whether any pattern of a matcher occurs in a string. The scan
+ * stops at the first match.
+ *
+ * @param mt The matcher.
+ * @param str The input string to search in.
+ * @return true if at least one pattern occurs in the string, false
+ *         otherwise.
+ **/
+bool string_matcher_any(const string_matcher_t *mt, const string_t *str);
+
+/**
+ * Finds all occurrences, including overlapping ones, of all patterns of a
+ * matcher in a string.
+ *
+ * @param mt The matcher.
+ * @param str The input string to search in.
+ * @param count Receives the number of matches found.
+ * @return A pointer to a newly allocated array of `*count` matches, ordered
+ *         by the end position of the match and, for matches ending at the
+ *         same position, from the longest to the shortest pattern; or NULL
+ *         if memory allocation failed. The returned array must be
+ *         deallocated using the standard C library function `free()`.
+ **/
+string_match_t *string_matcher_find_all(const string_matcher_t *mt,
+                                        const string_t *str, size_t *count);
+
+/**
+ * Creates a new string where all occurrences of the substrings in `old` are
+ * replaced with the substring at the same index in `new`, in a single pass
+ * over the input string.
+ *
+ * Where matches overlap, the leftmost one wins; among matches starting at
+ * the same position the longest wins, and among equally long ones the one
+ * that comes first in `old`. Replacements are not searched again.
+ *
+ * @param str The input string.
+ * @param old The substrings to be replaced. Empty substrings never match.
+ * @param new The replacement for each substring in `old`.
+ * @return A new string with replaced substrings, or NULL if `old` and `new`
+ *         differ in length or memory allocation failed. The returned string
+ *         must be deallocated using the standard C library function `free()`
+ *         when no longer needed.
+ **/
+string_t *string_replace_many(const string_t *str, const string_vector_t *old,
+                              const string_vector_t *new);
+
 /**********************************************************************/
 
 /**
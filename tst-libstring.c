@@ -1,5 +1,7 @@
 #include <assert.h>
 #include <ctype.h>
+#include <limits.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
@@ -115,6 +117,48 @@ void tst_filter() {
 
 /***********************************************************************/
 
+void tst_map_table() {
+  char table[256];
+  for (int c = 0; c < 256; c++)
+    table[c] = (char)toupper(c);
+  string_t *s1 = string_new("Hello World! ");
+  string_t *s2 = string_repeat(s1, 10);
+  string_t *s3 = string_map(to_upper, s2);
+  bool b = true;
+  for (int isa = LIBSTRING_ISA_SCALAR; isa <= LIBSTRING_ISA_AVX512; isa++) {
+    libstring_set_isa(isa);
+    string_t *s4 = string_map_table(s2, table);
+    b = b && string_equal(s3, s4);
+    free(s4);
+  }
+  libstring_set_isa(LIBSTRING_ISA_AVX512);
+  verify_bool("map table", s1, s2, b);
+  free(s3);
+}
+
+/***********************************************************************/
+
+void tst_filter_set() {
+  uint64_t set[4] = {0};
+  for (int c = 'A'; c <= 'Z'; c++)
+    set[c / 64] |= (uint64_t)1 << (c % 64);
+  string_t *s1 = string_nnew("Hello\0World! ", 14);
+  string_t *s2 = string_repeat(s1, 10);
+  string_t *s3 = string_new("HWHWHWHWHWHWHWHWHWHW");
+  bool b = true;
+  for (int isa = LIBSTRING_ISA_SCALAR; isa <= LIBSTRING_ISA_AVX512; isa++) {
+    libstring_set_isa(isa);
+    string_t *s4 = string_filter_set(s2, set);
+    b = b && string_equal(s3, s4);
+    free(s4);
+  }
+  libstring_set_isa(LIBSTRING_ISA_AVX512);
+  verify_bool("filter set", s1, s2, b);
+  free(s3);
+}
+
+/***********************************************************************/
+
 void tst_equal1() {
   string_t *s1 = string_new("Hello World!");
   string_t *s2 = string_new("Hello World!");
@@ -145,6 +189,40 @@ void tst_equal5() {
   verify("equal 5", s1, s2);
 }
 
+void tst_equal6() {
+  string_t *s1 = string_nnew("Hello\0World!", 12);
+  string_t *s2 = string_nnew("Hello\0Welt!!", 12);
+  verify_neg("equal 6", s1, s2);
+}
+
+void tst_equal7() {
+  string_t *s1 = string_new("Hello World! Hello World!");
+  string_t *s2 = string_new("Hello World! Hello World?");
+  string_t *s3 = string_new("Hello World! Hello World!");
+  string_hashed_t h1 = string_hashed(s1), h2 = string_hashed(s2);
+  string_hashed_t h3 = string_hashed(s3);
+  bool b = h1.hash != h2.hash && h1.hash == h3.hash &&
+           !string_hashed_equal(h1, h2) && string_hashed_equal(h1, h3);
+  free(s3);
+  verify_bool("equal 7", s1, s2, b);
+}
+
+/***********************************************************************/
+
+void tst_hash1() {
+  string_t *s1 = string_new("The quick brown fox jumps over the lazy dog, ");
+  string_t *s2 = string_repeat(s1, 5);
+  string_hasher_t h;
+  string_hasher_init(&h, 42);
+  for (size_t i = 0; i < s2->len; i += 7)
+    string_hasher_update(&h, s2->buf + i, (s2->len - i < 7) ? s2->len - i : 7);
+  bool b = string_hash(s2, 42) == string_hasher_final(&h);
+  b = b && string_hash(s2, 42) != string_hash(s2, 43);
+  b = b && string_hash(s1, 42) != string_hash(s2, 42);
+  b = b && string_view_hash(string_view(s2), 42) == string_hash(s2, 42);
+  verify_bool("hash 1", s1, s2, b);
+}
+
 /***********************************************************************/
 
 void tst_compare1() {
@@ -171,6 +249,12 @@ void tst_compare4() {
   verify_bool("compare 4", s1, s2, string_compare(s1, s2) == 0);
 }
 
+void tst_compare5() {
+  string_t *s1 = string_nnew("Hello\0\xff", 7);
+  string_t *s2 = string_nnew("Hello\0\x01", 7);
+  verify_bool("compare 5", s1, s2, string_compare(s1, s2) > 0);
+}
+
 /***********************************************************************/
 
 void tst_readfd() {
@@ -180,14 +264,54 @@ void tst_readfd() {
   string_t *s1 = string_new("Hello World!");
   char *s = string_tocstr(s1);
   assert(write(pfd[1], s, strlen(s)) == (ssize_t)strlen(s));
+  close(pfd[1]);
   string_t *s2 = string_readfd(pfd[0]);
 
   verify("readfd", s1, s2);
   close(pfd[0]);
-  close(pfd[1]);
   free(s);
 }
 
+void tst_readfd2() {
+  string_t *s1 = string_nnew("abc\0def\n", 8);
+  string_t *s2 = string_repeat(s1, 40000);
+  FILE *f = tmpfile();
+  assert(f != NULL);
+  assert(fwrite(s2->buf, 1, s2->len, f) == s2->len);
+  assert(fflush(f) == 0);
+  assert(lseek(fileno(f), 8, SEEK_SET) == 8);
+  string_t *s3 = string_readfd(fileno(f));
+
+  bool result = s3->len == s2->len - 8 &&
+                memcmp(s3->buf, s2->buf + 8, s3->len) == 0;
+  verify_bool("readfd 2", s2, s3, result);
+  fclose(f);
+  free(s1);
+}
+
+void tst_mmap1() {
+  char path[] = "/tmp/tst-libstring-XXXXXX";
+  int fd = mkstemp(path);
+  assert(fd != -1);
+  string_t *s1 = string_nnew("alpha,beta\0,gamma", 17);
+  assert(write(fd, s1->buf, s1->len) == (ssize_t)s1->len);
+  close(fd);
+
+  const string_t *m = string_mmap_file(path, STRING_MMAP_SEQUENTIAL);
+  string_t *s2 = string_new("gamma");
+  string_vector_t *svec = string_split(m, ',');
+  bool result = m != NULL && string_equal(m, s1) &&
+                string_substring_index(m, s2) == 12 &&
+                string_vector_len(svec) == 3 &&
+                string_view_equal(string_view(svec->buf[2]), string_view(s2));
+  string_vector_deepfree(svec);
+  string_munmap(m);
+
+  result = result && string_mmap_file("/tmp", 0) == NULL;
+  unlink(path);
+  verify_bool("mmap 1", s1, s2, result);
+}
+
 /***********************************************************************/
 
 void tst_substring() {
@@ -227,6 +351,30 @@ void tst_substring_index4() {
   verify_bool("substring index 4", s1, s2, r == 0);
 }
 
+void tst_substring_index5() {
+  string_t *s2 = string_new("the quick brown fox jumps over the lazy dog");
+  string_t *s3 = string_new("lorem ipsum dolor sit amet ");
+  string_t *s1 = string_repeat(s3, 100);
+  string_t *s4 = string_concat(s1, s2);
+  int r = string_substring_index(s4, s2);
+  verify_bool("substring index 5", s4, s2, r == (int)s1->len);
+  free(s1);
+  free(s3);
+}
+
+void tst_substring_index6() {
+  string_t *s1 = string_new("a");
+  string_t *s2 = string_repeat(s1, 5000);
+  string_t *s3 = string_repeat(s1, 99);
+  free(s1);
+  s1 = string_new("b");
+  string_t *s4 = string_concat(s3, s1);
+  int r = string_substring_index(s2, s4);
+  verify_bool("substring index 6", s2, s4, r == -1);
+  free(s1);
+  free(s3);
+}
+
 /***********************************************************************/
 
 void tst_is_substring1() {
@@ -243,6 +391,37 @@ void tst_is_substring2() {
 
 /***********************************************************************/
 
+void tst_needle1() {
+  string_t *s1 = string_new("GET /index.html GET /favicon.ico");
+  string_t *s2 = string_new("/favicon");
+  string_needle_t *needle = string_needle_new(s2);
+  verify_bool("needle 1", s1, s2, string_needle_find(needle, s1) == 20);
+  free(needle);
+}
+
+void tst_needle2() {
+  string_t *s1 = string_new("aaaaaaaaa");
+  string_t *s2 = string_new("aa");
+  string_needle_t *needle = string_needle_new(s2);
+  verify_bool("needle 2", s1, s2, string_needle_count(needle, s1) == 4);
+  free(needle);
+}
+
+void tst_needle3() {
+  string_t *s1 = string_new("THISFOOISFOOAFOOTEST");
+  string_t *s2 = string_new("FOO");
+  string_needle_t *needle = string_needle_new(s2);
+  size_t n;
+  size_t *offsets = string_needle_find_all(needle, s1, &n);
+  bool result = (n == 3) && (offsets[0] == 4) && (offsets[1] == 9) &&
+                (offsets[2] == 13);
+  verify_bool("needle 3", s1, s2, result);
+  free(offsets);
+  free(needle);
+}
+
+/***********************************************************************/
+
 void tst_readline() {
   string_t *s1 = string_new("#include <assert.h>");
   FILE *f = fopen("tst-libstring.c", "r");
@@ -251,6 +430,39 @@ void tst_readline() {
   verify("readline", s1, s2);
 }
 
+void tst_line_reader1() {
+  int pfd[2];
+  assert(pipe(pfd) != -1);
+  string_t *s1 = string_new("x");
+  string_t *s2 = string_repeat(s1, 100);
+  const char *in[] = {"a\r\nbb\n\n", s2->buf, "\r", "\nlast"};
+  for (size_t i = 0; i < 4; i++) {
+    size_t n = (i == 1) ? s2->len : strlen(in[i]);
+    assert(write(pfd[1], in[i], n) == (ssize_t)n);
+  }
+  close(pfd[1]);
+
+  string_line_reader_t *r = string_line_reader_new(pfd[0], 16);
+  const char *out[] = {"a", "bb", "", NULL, "last"};
+  enum string_line_ending eol[] = {STRING_EOL_CRLF, STRING_EOL_LF,
+                                   STRING_EOL_LF, STRING_EOL_CRLF,
+                                   STRING_EOL_NONE};
+  string_view_t line;
+  enum string_line_ending e;
+  bool result = true;
+  for (size_t i = 0; i < 5; i++) {
+    string_view_t v = out[i] ? (string_view_t){strlen(out[i]), out[i]}
+                             : string_view(s2);
+    result = result && string_line_reader_next(r, &line, &e) &&
+             string_view_equal(line, v) && e == eol[i];
+  }
+  result = result && !string_line_reader_next(r, &line, NULL) &&
+           string_line_reader_error(r) == 0;
+  string_line_reader_free(r);
+  close(pfd[0]);
+  verify_bool("line reader 1", s1, s2, result);
+}
+
 /***********************************************************************/
 
 void tst_repeat1() {
@@ -309,6 +521,41 @@ void tst_replacec3() {
 
 /***********************************************************************/
 
+void tst_chars1() {
+  string_t *s1 = string_new("\t\r\n ");
+  string_t *s2 = string_new("word, word; word.");
+  string_t *s3 = string_repeat(s1, 20);
+  string_t *s4 = string_repeat(s2, 7);
+  string_t *s5 = string_concat(s3, s4);
+  string_t *s6 = string_concat(s5, s3);
+  string_t *set = string_new(";.");
+  string_t *e1 = string_replace_char(s6, 'w', 'W');
+  bool b = true;
+  for (int isa = LIBSTRING_ISA_SCALAR; isa <= LIBSTRING_ISA_AVX512; isa++) {
+    libstring_set_isa(isa);
+    string_t *t = string_trim(s6);
+    string_t *r = string_replace_char(s6, 'w', 'W');
+    b = b && string_equal(t, s4) && string_equal(r, e1);
+    b = b && string_count_char(s6, ',') == 7;
+    b = b && string_count_char(s6, 'w') == 21;
+    b = b && string_find_char(s6, 'w') == 80 && string_find_char(s6, '!') == -1;
+    b = b && string_find_any_of(s6, set) == 90;
+    b = b && string_find_any_of(s3, set) == -1;
+    free(t);
+    free(r);
+  }
+  libstring_set_isa(LIBSTRING_ISA_AVX512);
+  verify_bool("chars 1", s1, s2, b);
+  free(s3);
+  free(s4);
+  free(s5);
+  free(s6);
+  free(set);
+  free(e1);
+}
+
+/***********************************************************************/
+
 void tst_replace1() {
   string_t *s1 = string_new("Hello World!");
   string_t *s2 = string_new("Hallo World!");
@@ -363,6 +610,93 @@ void tst_replace4() {
 
 /***********************************************************************/
 
+void tst_replace5() {
+  string_t *s1 = string_new("a,");
+  string_t *s2 = string_new("b;");
+  string_t *s3 = string_repeat(s1, 1000);
+  string_t *s4 = string_repeat(s2, 1000);
+  string_t *old = string_new(",");
+  string_t *new = string_new(";");
+  string_t *s5 = string_replace_char(s3, 'a', 'b');
+  string_t *s6 = string_replace(s5, old, new);
+  verify("replace 5", s4, s6);
+  free(s1);
+  free(s2);
+  free(s3);
+  free(s5);
+  free(old);
+  free(new);
+}
+
+/***********************************************************************/
+
+void tst_replace_many1() {
+  string_t *s1 = string_new("the cat sat on the mat");
+  string_t *s2 = string_new("a dog sat under a mat");
+  string_vector_t *old = string_vector_empty();
+  string_vector_t *new = string_vector_empty();
+  string_vector_add(old, string_new("the"));
+  string_vector_add(new, string_new("a"));
+  string_vector_add(old, string_new("cat"));
+  string_vector_add(new, string_new("dog"));
+  string_vector_add(old, string_new("on"));
+  string_vector_add(new, string_new("under"));
+  string_t *s3 = string_replace_many(s1, old, new);
+  verify("replace many 1", s2, s3);
+  free(s1);
+  string_vector_deepfree(old);
+  string_vector_deepfree(new);
+}
+
+void tst_replace_many2() {
+  string_t *s1 = string_new("abcd");
+  string_t *s2 = string_new("Xd");
+  string_vector_t *old = string_vector_empty();
+  string_vector_t *new = string_vector_empty();
+  string_vector_add(old, string_new("bc"));
+  string_vector_add(new, string_new("Y"));
+  string_vector_add(old, string_new("abc"));
+  string_vector_add(new, string_new("X"));
+  string_t *s3 = string_replace_many(s1, old, new);
+  verify("replace many 2", s2, s3);
+  free(s1);
+  string_vector_deepfree(old);
+  string_vector_deepfree(new);
+}
+
+/***********************************************************************/
+
+void tst_builder1() {
+  string_t *s1 = string_new("Hello");
+  string_builder_t *sb = string_builder_new(4);
+  bool result = string_builder_append(sb, s1) &&
+                string_builder_append_char(sb, ' ') &&
+                string_builder_append_cstr(sb, "World ") &&
+                string_builder_append_int(sb, -9223372036854775807LL - 1) &&
+                string_builder_append_char(sb, ' ') &&
+                string_builder_append_int(sb, 0) &&
+                string_builder_append_format(sb, " %s:%d", "x", 42);
+  string_t *s2 = string_builder_finish(sb);
+  free(s1);
+  s1 = string_new("Hello World -9223372036854775808 0 x:42");
+  verify_bool("builder 1", s1, s2, result && string_equal(s1, s2));
+}
+
+void tst_builder2() {
+  string_t *s1 = string_new("0123456789");
+  string_t *s2 = string_repeat(s1, 1000);
+  string_builder_t *sb = string_builder_new(0);
+  bool result = string_builder_reserve(sb, 5);
+  for (int i = 0; i < 1000; i++)
+    result = result && string_builder_append_format(sb, "%.*s", 10, s1->buf);
+  result = result && string_builder_len(sb) == 10000 &&
+           string_view_equal(string_builder_view(sb), string_view(s2));
+  string_builder_free(sb);
+  verify_bool("builder 2", s1, s2, result);
+}
+
+/***********************************************************************/
+
 void string_tests() {
   tst_colored();
   tst_concat1();
@@ -371,33 +705,53 @@ void string_tests() {
   tst_trim2();
   tst_map();
   tst_filter();
+  tst_map_table();
+  tst_filter_set();
   tst_equal1();
   tst_equal2();
   tst_equal3();
   tst_equal4();
   tst_equal5();
+  tst_equal6();
+  tst_equal7();
   tst_compare1();
   tst_compare2();
   tst_compare3();
   tst_compare4();
+  tst_compare5();
+  tst_hash1();
   tst_readfd();
+  tst_readfd2();
+  tst_mmap1();
   tst_substring_index1();
   tst_substring_index2();
   tst_substring_index3();
   tst_substring_index4();
+  tst_substring_index5();
+  tst_substring_index6();
   tst_is_substring1();
   tst_is_substring2();
+  tst_needle1();
+  tst_needle2();
+  tst_needle3();
   tst_readline();
+  tst_line_reader1();
   tst_repeat1();
   tst_repeat2();
   tst_repeat3();
   tst_replacec1();
   tst_replacec2();
   tst_replacec3();
+  tst_chars1();
   tst_replace1();
   tst_replace2();
   tst_replace3();
   tst_replace4();
+  tst_replace5();
+  tst_replace_many1();
+  tst_replace_many2();
+  tst_builder1();
+  tst_builder2();
 }
 
 /**********************************************************************/
@@ -484,6 +838,33 @@ void test_strvec_find2() {
 
 /**********************************************************************/
 
+void test_strvec_find3() {
+  string_t *s1 = string_new("key 7");
+  string_t *s2 = string_new("key 1000");
+  string_vector_t *svec = string_vector_empty();
+  char buf[32];
+  for (int i = 0; i < 1000; i++) {
+    snprintf(buf, sizeof(buf), "key %d", i % 500);
+    string_vector_add(svec, string_new(buf));
+  }
+  bool result = string_vector_index(svec) &&
+                string_vector_index_bytes(svec) > 0 &&
+                string_vector_find(svec, s1) == 7;
+  free(string_vector_remove(svec, 7));
+  result = result && string_vector_find(svec, s1) == 506;
+  free(string_vector_remove(svec, 0));
+  string_vector_add(svec, string_new("key 1000"));
+  result = result && string_vector_find(svec, s1) == 505 &&
+           string_vector_find(svec, s2) == 998;
+  string_vector_unindex(svec);
+  result = result && string_vector_index_bytes(svec) == 0 &&
+           string_vector_find(svec, s2) == 998;
+  verify_bool("string vector find 3", s1, s2, result);
+  string_vector_deepfree(svec);
+}
+
+/**********************************************************************/
+
 void test_strvec_remove1() {
   string_t *s1 = string_new("Hello");
   string_vector_t *svec = string_vector_new(s1);
@@ -579,6 +960,202 @@ void test_strvec_filter() {
 
 /**********************************************************************/
 
+void test_strvec_swap_remove() {
+  string_t *s1 = string_new("FOO");
+  string_t *s2 = string_new("BAR");
+  string_t *s3 = string_new("BAZ");
+  string_t *s4 = string_new("BAR");
+
+  string_vector_t *svec = string_vector_new(s1);
+  string_vector_add(svec, s2);
+  string_vector_add(svec, s3);
+  string_vector_add(svec, s4);
+  string_vector_index(svec);
+
+  bool result = string_vector_find(svec, s4) == 1 &&
+                string_vector_swap_remove(svec, 1) == s2 &&
+                string_vector_len(svec) == 3 &&
+                string_vector_get(svec, 1) == s4 &&
+                string_vector_find(svec, s2) == 1 &&
+                string_vector_swap_remove(svec, 2) == s3 &&
+                string_vector_swap_remove(svec, 2) == NULL;
+
+  verify_bool("string vector swap remove", s1, s2, result);
+
+  free(s3);
+  free(s4);
+  string_vector_free(svec);
+}
+
+/**********************************************************************/
+
+void test_strvec_erase() {
+  string_t *s1 = string_new("a b c d e f");
+  string_t *s2 = string_new("a e f");
+  string_vector_t *svec = string_split(s1, ' ');
+  string_vector_t *expected = string_split(s2, ' ');
+
+  bool result = string_vector_erase(svec, 1, 4) == 3 &&
+                string_vector_erase(svec, 2, 2) == 0 &&
+                string_vector_erase(svec, 3, 9) == 0 &&
+                string_vector_equal(svec, expected) &&
+                string_vector_erase(svec, 1, 9) == 2 &&
+                string_vector_len(svec) == 1;
+
+  verify_bool("string vector erase", s1, s2, result);
+  string_vector_deepfree(svec);
+  string_vector_deepfree(expected);
+}
+
+/**********************************************************************/
+
+void test_strvec_remove_if() {
+  string_t *s1 = string_new("ab AB cd CD ef");
+  string_t *s2 = string_new("ab cd ef");
+  string_vector_t *svec = string_split(s1, ' ');
+  string_vector_t *expected = string_split(s2, ' ');
+
+  bool result = string_vector_remove_if(svec, strisupper) == 2 &&
+                string_vector_equal(svec, expected) &&
+                string_vector_remove_if(svec, strisupper) == 0;
+
+  verify_bool("string vector remove if", s1, s2, result);
+  string_vector_deepfree(svec);
+  string_vector_deepfree(expected);
+}
+
+/**********************************************************************/
+
+void test_strvec_extend() {
+  string_t *s1 = string_new("x y");
+  string_t *s2 = string_new("x y 0 1 2 3 4 5 6 7 8 9");
+  string_vector_t *svec = string_split(s1, ' ');
+  string_vector_t *expected = string_split(s2, ' ');
+  string_t *strs[10];
+  for (int i = 0; i < 10; i++)
+    strs[i] = string_nnew((char[]){'0' + i}, 1);
+
+  bool result = string_vector_reserve(svec, 100) && svec->cap >= 102 &&
+                string_vector_extend(svec, strs, 10) &&
+                string_vector_shrink_to_fit(svec) && svec->cap == 12 &&
+                string_vector_equal(svec, expected);
+
+  verify_bool("string vector extend", s1, s2, result);
+  string_vector_deepfree(svec);
+  string_vector_deepfree(expected);
+}
+
+/**********************************************************************/
+
+void test_strvec_sort1() {
+  string_t *s1 = string_new("pear apple applesauce app apple\xff fig "
+                            "apple0123456789 apple012345678 apple");
+  string_t *s2 = string_new("app apple apple apple012345678 "
+                            "apple0123456789 applesauce apple\xff fig pear");
+  string_vector_t *svec = string_split(s1, ' ');
+  string_vector_t *expected = string_split(s2, ' ');
+  string_t *first = svec->buf[1];
+
+  bool result = string_vector_sort_stable(svec) && svec->buf[1] == first &&
+                string_vector_equal(svec, expected);
+  string_vector_add(svec, string_nnew("app\0", 4));
+  result = result && string_vector_sort(svec) &&
+           string_len(svec->buf[1]) == 4;
+  verify_bool("string vector sort 1", s1, s2, result);
+  string_vector_deepfree(svec);
+  string_vector_deepfree(expected);
+}
+
+/**********************************************************************/
+
+void test_strvec_sort2() {
+  string_t *s1 = string_new("parallel");
+  string_t *s2 = string_new("sort");
+  string_vector_t *svec = string_vector_empty();
+  char buf[32];
+  for (size_t i = 0; i < 150000; i++) {
+    snprintf(buf, sizeof(buf), "key-%zu", i * 7919 % 150000);
+    string_vector_add(svec, string_new(buf));
+  }
+  bool result = string_vector_sort_parallel(svec, 3);
+  for (size_t i = 1; i < string_vector_len(svec); i++)
+    result = result && string_compare(svec->buf[i - 1], svec->buf[i]) < 0;
+  verify_bool("string vector sort 2", s1, s2, result);
+  string_vector_deepfree(svec);
+}
+
+/**********************************************************************/
+
+void test_strvec_set1() {
+  string_t *s1 = string_new("pear fig apple fig kiwi pear");
+  string_t *s2 = string_new("kiwi plum fig plum");
+  string_vector_t *a = string_split(s1, ' ');
+  string_vector_t *b = string_split(s2, ' ');
+  string_vector_t *u = string_vector_union(a, b);
+  string_vector_t *i = string_vector_intersect(a, b);
+  string_vector_t *d = string_vector_difference(a, b);
+  string_t *e1 = string_new("pear fig apple kiwi plum");
+  string_t *e2 = string_new("fig kiwi");
+  string_t *e3 = string_new("pear apple");
+  string_vector_t *eu = string_split(e1, ' ');
+  string_vector_t *ei = string_split(e2, ' ');
+  string_vector_t *ed = string_split(e3, ' ');
+
+  bool result = string_vector_equal(u, eu) && string_vector_equal(i, ei) &&
+                string_vector_equal(d, ed);
+  string_vector_t *empty = string_vector_empty();
+  string_vector_t *none = string_vector_intersect(a, empty);
+  result = result && none != NULL && string_vector_len(none) == 0;
+  result = result && string_vector_unique(a) &&
+           string_vector_len(a) == 4 && string_vector_find(a, a->buf[3]) == 3;
+  result = result && string_vector_difference_inplace(a, b) &&
+           string_vector_equal(a, ed);
+  result = result && string_vector_union_inplace(a, b) &&
+           string_vector_len(a) == 5;
+  verify_bool("string vector set 1", s1, s2, result);
+  string_vector_deepfree(a);
+  string_vector_deepfree(b);
+  string_vector_deepfree(u);
+  string_vector_deepfree(i);
+  string_vector_deepfree(d);
+  string_vector_deepfree(eu);
+  string_vector_deepfree(ei);
+  string_vector_deepfree(ed);
+  string_vector_deepfree(empty);
+  string_vector_deepfree(none);
+  free(e1);
+  free(e2);
+  free(e3);
+}
+
+/**********************************************************************/
+
+void test_strvec_set2() {
+  string_t *s1 = string_new("a b b c e e g");
+  string_t *s2 = string_new("b c d e e");
+  string_vector_t *a = string_split(s1, ' ');
+  string_vector_t *b = string_split(s2, ' ');
+  string_vector_t *u = string_vector_union(a, b);
+  string_t *e1 = string_new("a b c d e g");
+  string_t *e2 = string_new("b c e");
+  string_vector_t *eu = string_split(e1, ' ');
+  string_vector_t *ei = string_split(e2, ' ');
+
+  bool result = string_vector_equal(u, eu);
+  result = result && string_vector_intersect_inplace(a, b) &&
+           string_vector_equal(a, ei);
+  verify_bool("string vector set 2", s1, s2, result);
+  string_vector_deepfree(a);
+  string_vector_deepfree(b);
+  string_vector_deepfree(u);
+  string_vector_deepfree(eu);
+  string_vector_deepfree(ei);
+  free(e1);
+  free(e2);
+}
+
+/**********************************************************************/
+
 void test_strvec_split1() {
   string_t *str = string_new("Green,Blue,White,Black,Red,Yellow,Magenta");
   string_vector_t *svec = string_split(str, ';');
@@ -708,6 +1285,42 @@ void test_strvec_ssplit3() {
 
 /**********************************************************************/
 
+void test_strvec_ssplit4() {
+  string_t *str = string_new("a\rb\r\nc\r\n\r\nd");
+  string_t *del = string_new("\r\n");
+  string_vector_t *svec = string_vector_empty();
+  string_vector_add(svec, string_new("a\rb"));
+  string_vector_add(svec, string_new("c"));
+  string_vector_add(svec, string_new("\r\nd"));
+
+  string_vector_t *rvec = string_ssplit_n(str, del, 2);
+  bool result = string_vector_equal(svec, rvec);
+  string_vector_deepfree(rvec);
+
+  string_needle_t *needle = string_needle_new(del);
+  string_ssplit_iter_t it =
+      string_ssplit_iter(string_view(str), needle, STRING_SPLIT_ALL);
+  string_view_t field;
+  size_t n = 0;
+  while (string_ssplit_next(&it, &field))
+    n += 1;
+  result = result && n == 4 && field.len == 1 && field.buf[0] == 'd';
+  free(needle);
+
+  string_t *s1 = string_new("aaaaa");
+  string_t *s2 = string_new("aa");
+  rvec = string_ssplit(s1, s2);
+  result = result && string_vector_len(rvec) == 3 && rvec->buf[2]->len == 1;
+  string_vector_deepfree(rvec);
+  free(s1);
+  free(s2);
+
+  verify_bool("string vector ssplit 4", str, del, result);
+  string_vector_deepfree(svec);
+}
+
+/**********************************************************************/
+
 void test_strvec_reduce1() {
   string_vector_t *svec = string_vector_empty();
   string_vector_add(svec, string_new("Foo"));
@@ -733,6 +1346,481 @@ void test_strvec_reduce2() {
   free(init);
   string_vector_deepfree(svec);
 }
+
+/**********************************************************************/
+
+void test_strvec_parallel() {
+  string_t *s1 = string_new("map filter");
+  string_t *s2 = string_new("reduce");
+  string_vector_t *svec = string_vector_empty();
+  char buf[32];
+  for (size_t i = 0; i < 20000; i++) {
+    int len = snprintf(buf, sizeof(buf), "%zu", i);
+    for (int k = 0; k < len; k++)
+      buf[k] += ((i % 3) ? 'a' : 'A') - '0';
+    string_vector_add(svec, string_new(buf));
+  }
+  string_vector_t *m1 = string_vector_map(strtoupper, svec);
+  string_vector_t *m2 = string_vector_map_parallel(strtoupper, svec, 4);
+  string_vector_t *f1 = string_vector_filter(strisupper, svec);
+  string_vector_t *f2 = string_vector_filter_parallel(strisupper, svec, 4);
+  string_t *init = string_new("FNORD");
+  string_t *r1 = string_vector_reduce(fold, svec, init);
+  string_t *r2 = string_vector_reduce_parallel(fold, svec, init, 4);
+
+  bool result = string_vector_equal(m1, m2) && string_vector_equal(f1, f2) &&
+                string_vector_len(f2) == 6667 && string_equal(r1, r2);
+  verify_bool("string vector parallel", s1, s2, result);
+  string_vector_deepfree(svec);
+  string_vector_deepfree(m1);
+  string_vector_deepfree(m2);
+  string_vector_deepfree(f1);
+  string_vector_deepfree(f2);
+  free(init);
+  free(r1);
+  free(r2);
+}
+
+/**********************************************************************/
+
+void test_matcher1() {
+  string_t *str = string_new("ushers");
+  string_vector_t *pvec = string_vector_empty();
+  string_vector_add(pvec, string_new("he"));
+  string_vector_add(pvec, string_new("she"));
+  string_vector_add(pvec, string_new("his"));
+  string_vector_add(pvec, string_new("hers"));
+  string_matcher_t *mt = string_matcher_new(pvec);
+
+  size_t n;
+  string_match_t *m = string_matcher_find_all(mt, str, &n);
+  bool result = (n == 3) && (m[0].pattern == 1) && (m[0].offset == 1) &&
+                (m[1].pattern == 0) && (m[1].offset == 2) &&
+                (m[2].pattern == 3) && (m[2].offset == 2);
+  verify_bool("string matcher 1", str, str, result);
+
+  free(m);
+  string_matcher_free(mt);
+  string_vector_deepfree(pvec);
+}
+
+/**********************************************************************/
+
+void test_matcher2() {
+  string_t *s1 = string_new("GET /index.html HTTP/1.1");
+  string_t *s2 = string_new("POST /login HTTP/1.0");
+  string_vector_t *pvec = string_vector_empty();
+  string_vector_add(pvec, string_new("PUT"));
+  string_vector_add(pvec, string_new("/1.0"));
+  string_matcher_t *mt = string_matcher_new(pvec);
+
+  bool result = !string_matcher_any(mt, s1) && string_matcher_any(mt, s2);
+  verify_bool("string matcher 2", s1, s2, result);
+
+  string_matcher_free(mt);
+  string_vector_deepfree(pvec);
+}
+
+/**********************************************************************/
+
+void test_view1() {
+  string_t *str = string_new("  key = value\t");
+  string_view_t v = string_view_trim(string_view(str));
+  string_view_t key = string_view_substring(v, 0, 3);
+  string_view_t val = string_view_substring(v, 6, v.len);
+  string_t *s1 = string_new("key");
+  string_t *s2 = string_new("value");
+
+  bool result = (v.buf == str->buf + 2) &&
+                string_view_equal(key, string_view(s1)) &&
+                string_view_compare(val, string_view(s2)) == 0 &&
+                string_view_compare(key, val) < 0 &&
+                string_view_index(v, string_view(s2)) == 6 &&
+                string_view_substring(v, 4, 20).buf == NULL;
+  verify_bool("string view 1", s1, s2, result);
+  free(str);
+}
+
+/**********************************************************************/
+
+void test_view_split1() {
+  string_t *str = string_new("Green,Blue,,Red");
+  string_view_vector_t *vvec = string_view_split(string_view(str), ',');
+  string_t *s1 = string_view_tostring(string_view_vector_get(vvec, 1));
+  string_t *s2 = string_new("Blue");
+
+  bool result = (string_view_vector_len(vvec) == 4) &&
+                (string_view_vector_get(vvec, 2).len == 0) &&
+                (string_view_vector_get(vvec, 3).buf == str->buf + 12);
+  verify_bool("string view split 1", s1, s2, result && string_equal(s1, s2));
+
+  string_view_vector_free(vvec);
+  free(str);
+}
+
+void test_split_iter1() {
+  string_t *s1 = string_new("field,");
+  string_t *s2 = string_repeat(s1, 30);
+  string_split_iter_t it = string_split_iter(string_view(s2), ',');
+  string_view_t field;
+  size_t n = 0;
+  bool result = true;
+  while (string_split_next(&it, &field)) {
+    result = result && field.buf == s2->buf + 6 * n &&
+             field.len == ((n < 30) ? 5 : 0);
+    n += 1;
+  }
+  result = result && n == 31 && !string_split_next(&it, &field);
+
+  it = string_split_iter((string_view_t){0, ""}, ',');
+  result = result && string_split_next(&it, &field) && field.len == 0 &&
+           !string_split_next(&it, &field);
+  verify_bool("string split iter 1", s1, s2, result);
+}
+
+void test_view_ssplit1() {
+  string_t *str = string_new("THISFOOISFOOAFOOTEST");
+  string_t *del = string_new("FOO");
+  string_view_vector_t *vvec =
+      string_view_ssplit(string_view(str), string_view(del));
+  string_vector_t *svec = string_ssplit(str, del);
+
+  bool result = string_view_vector_len(vvec) == string_vector_len(svec);
+  for (size_t i = 0; result && i < string_vector_len(svec); i++)
+    result = string_view_equal(string_view_vector_get(vvec, i),
+                               string_view(string_vector_get(svec, i)));
+  verify_bool("string view ssplit 1", str, del, result);
+
+  string_view_vector_free(vvec);
+  string_vector_deepfree(svec);
+}
+
+/**********************************************************************/
+
+void test_arena1() {
+  string_arena_t *arena = string_arena_create(256);
+  string_t *str = string_new("a,b,c,d,e,f,g,h,i,j,k,l,m,n,o,p,q,r,s,t,u,v");
+  string_t *big = string_repeat(str, 20);
+  string_t *s3 = string_new("av");
+  string_vector_t *svec = string_arena_split(arena, str, ',');
+  string_t *s1 = string_arena_concat(arena, svec->buf[0], svec->buf[21]);
+  string_t *s2 = string_arena_clone(arena, big);
+
+  bool result = (string_vector_len(svec) == 22) && (svec->arena == arena) &&
+                string_equal(s1, s3) && string_equal(s2, big);
+  string_vector_deepfree(svec);
+
+  string_arena_reset(arena);
+  s1 = string_arena_new(arena, "Hello");
+  s2 = string_arena_substring(arena, s1, 1, 4);
+  result = result && (s2->len == 3) && memcmp(s2->buf, "ell", 3) == 0 &&
+           string_arena_alloc(arena, SIZE_MAX) == NULL &&
+           string_arena_alloc(arena, SIZE_MAX - 8) == NULL;
+  verify_bool("string arena 1", str, s3, result);
+
+  free(big);
+  string_arena_free(arena);
+}
+
+/***********************************************************************/
+
+void test_flatvec1() {
+  string_t *s1 = string_new("pear");
+  string_t *s2 = string_nnew("fig\0", 4);
+  string_flatvec_t *fvec = string_flatvec_empty();
+  const char *words[] = {"plum", "", "fig", "apple", "pear", "fig"};
+  bool result = true;
+  for (int i = 0; i < 100; i++)
+    result = result && string_flatvec_add_view(
+                           fvec, (string_view_t){strlen(words[i % 6]),
+                                                 words[i % 6]});
+  result = result && string_flatvec_add(fvec, s2) &&
+           string_flatvec_len(fvec) == 101 &&
+           string_flatvec_find(fvec, s1) == 4 &&
+           string_flatvec_find(fvec, s2) == 100 &&
+           string_flatvec_get(fvec, 101).buf == NULL;
+
+  string_vector_t *svec = string_flatvec_tovector(fvec);
+  string_flatvec_t *copy = string_flatvec_from_vector(svec);
+  result = result && string_vector_len(svec) == 101 &&
+           string_view_equal(string_flatvec_get(copy, 3),
+                             string_view(string_vector_get(svec, 3))) &&
+           string_flatvec_sort(copy);
+  for (size_t i = 1; i < string_flatvec_len(copy); i++)
+    result = result && string_view_compare(string_flatvec_get(copy, i - 1),
+                                           string_flatvec_get(copy, i)) <= 0;
+  result = result && string_flatvec_get(copy, 0).len == 0 &&
+           string_flatvec_find(copy, s2) == 67;
+  verify_bool("flat vector 1", s1, s2, result);
+  string_vector_deepfree(svec);
+  string_flatvec_free(copy);
+  string_flatvec_free(fvec);
+}
+
+/***********************************************************************/
+
+void test_flatvec2() {
+  string_t *s1 = string_new(",alpha,,beta,gamma,");
+  string_t *s2 = string_new("");
+  string_flatvec_t *fvec = string_split_flat(s1, ',');
+  string_vector_t *svec = string_split(s1, ',');
+  string_vector_t *back = string_flatvec_tovector(fvec);
+  string_flatvec_t *empty = string_split_flat(s2, ',');
+  bool result = string_vector_equal(svec, back) &&
+                string_flatvec_len(empty) == 1 &&
+                string_flatvec_get(empty, 0).len == 0;
+  verify_bool("flat vector split", s1, s2, result);
+  string_vector_deepfree(svec);
+  string_vector_deepfree(back);
+  string_flatvec_free(fvec);
+  string_flatvec_free(empty);
+}
+
+/***********************************************************************/
+
+void test_map1() {
+  string_map_t *map = string_map_new(0);
+  string_t *s1 = string_new("key 0");
+  string_t *s2 = string_new("key 1000");
+  char buf[32];
+  bool result = true;
+  for (size_t i = 0; i < 1000; i++) {
+    snprintf(buf, sizeof(buf), "key %zu", i);
+    string_t *key = string_new(buf);
+    result = result && string_map_insert(map, key, (void *)(i + 1));
+    free(key);
+  }
+  result = result && string_map_insert(map, s1, (void *)42);
+  result = result && string_map_len(map) == 1000 &&
+           *string_map_find(map, s1) == (void *)42 &&
+           string_map_find(map, s2) == NULL;
+  for (size_t i = 0; i < 1000; i += 2) {
+    snprintf(buf, sizeof(buf), "key %zu", i);
+    string_t *key = string_new(buf);
+    result = result && string_map_erase(map, key) &&
+             !string_map_erase(map, key);
+    free(key);
+  }
+  size_t pos = 0, n = 0, sum = 0;
+  const string_t *key;
+  void *value;
+  while (string_map_next(map, &pos, &key, &value)) {
+    n += 1;
+    sum += (size_t)value;
+  }
+  result = result && n == 500 && string_map_len(map) == 500 &&
+           sum == 500 * 501 && string_map_find(map, s1) == NULL &&
+           *string_map_find_view(map, (string_view_t){7, "key 999"}) ==
+               (void *)1000;
+  verify_bool("string map 1", s1, s2, result);
+  string_map_free(map);
+}
+
+/***********************************************************************/
+
+void test_map2() {
+  libstring_alloc_stats_t steady, after;
+  libstring_allocator_t counting = libstring_counting_allocator(NULL);
+  string_t *s1 = string_new("session 199999");
+  string_t *s2 = string_new("session 199900");
+  libstring_set_allocator(&counting);
+  string_map_t *map = string_map_new(0);
+  char buf[32];
+  bool result = true;
+  for (size_t i = 0; i < 200000; i++) {
+    snprintf(buf, sizeof(buf), "session %zu", i);
+    string_t *key = string_new(buf);
+    result = result && string_map_insert(map, key, (void *)(i + 1));
+    libstring_free(key);
+    if (i < 100)
+      continue;
+    snprintf(buf, sizeof(buf), "session %zu", i - 100);
+    key = string_new(buf);
+    result = result && string_map_erase(map, key);
+    libstring_free(key);
+    if (i == 20000)
+      libstring_alloc_stats(&steady);
+  }
+  libstring_alloc_stats(&after);
+  result = result && string_map_len(map) == 100 &&
+           *string_map_find(map, s1) == (void *)200000 &&
+           string_map_find(map, s2) != NULL &&
+           after.live_bytes <= steady.live_bytes + 65536;
+  string_map_free(map);
+  libstring_set_allocator(NULL);
+  verify_bool("string map 2", s1, s2, result);
+}
+
+/***********************************************************************/
+
+void test_intern1() {
+  string_intern_t *intern = string_intern_new();
+  string_t *s1 = string_new("status=active");
+  string_t *s2 = string_nnew("status=\0active", 14);
+  string_t *s3 = string_new("record: status=active, id=7");
+  const string_t *i1 = string_intern(intern, s1);
+  const string_t *i2 = string_intern(intern, s2);
+  const string_t *i3 =
+      string_intern_view(intern, string_view_substring(string_view(s3), 8, 21));
+  bool result = i1 != s1 && i1 == i3 && i1 != i2 && i2->len == 14 &&
+                string_equal(i1, s1) && string_intern_len(intern) == 2 &&
+                string_intern_find(intern, string_view(s2)) == i2 &&
+                string_intern_find(intern, string_view(s3)) == NULL;
+  free(s3);
+  verify_bool("intern 1", s1, s2, result);
+  string_intern_free(intern);
+}
+
+/***********************************************************************/
+
+#define INTERN_THREADS 4
+#define INTERN_KEYS 20000
+
+static void *intern_keys(void *arg) {
+  string_intern_t *intern = arg;
+  const string_t **handles = malloc(INTERN_KEYS * sizeof(*handles));
+  char buf[32];
+  for (size_t i = 0; i < INTERN_KEYS; i++) {
+    int n = snprintf(buf, sizeof(buf), "field-%zu", i);
+    handles[i] = string_intern_view(intern, (string_view_t){n, buf});
+  }
+  return handles;
+}
+
+void test_intern2() {
+  string_intern_t *intern = string_intern_new();
+  pthread_t threads[INTERN_THREADS];
+  const string_t **handles[INTERN_THREADS];
+  string_t *s1 = string_new("field-12345");
+  string_t *s2 = string_new("field-20000");
+  for (int i = 0; i < INTERN_THREADS; i++)
+    pthread_create(&threads[i], NULL, intern_keys, intern);
+  for (int i = 0; i < INTERN_THREADS; i++)
+    pthread_join(threads[i], (void **)&handles[i]);
+  bool result = string_intern_len(intern) == INTERN_KEYS &&
+                string_intern_find(intern, string_view(s1)) ==
+                    handles[0][12345] &&
+                string_intern_find(intern, string_view(s2)) == NULL;
+  for (size_t k = 0; k < INTERN_KEYS; k++)
+    for (int i = 1; i < INTERN_THREADS; i++)
+      result = result && handles[i][k] == handles[0][k];
+  for (int i = 0; i < INTERN_THREADS; i++)
+    free(handles[i]);
+  verify_bool("intern 2", s1, s2, result);
+  string_intern_free(intern);
+}
+
+/***********************************************************************/
+
+static size_t alloc_count(const char *function) {
+  libstring_alloc_count_t counts[256];
+  size_t n = libstring_alloc_counts(counts, 256);
+  for (size_t i = 0; i < n && i < 256; i++)
+    if (strcmp(counts[i].function, function) == 0)
+      return counts[i].allocs;
+  return 0;
+}
+
+void test_allocator1() {
+  libstring_alloc_stats_t before, during, after;
+  libstring_allocator_t counting = libstring_counting_allocator(NULL);
+  libstring_set_allocator(&counting);
+  bool result = libstring_alloc_stats(&before);
+  size_t n = alloc_count("string_concat");
+
+  string_t *s1 = string_new("Hello ");
+  string_t *s2 = string_new("World");
+  string_t *s3 = string_concat(s1, s2);
+  string_vector_t *svec = string_split(s3, 'o');
+  for (int i = 0; i < 20; i++)
+    string_vector_add(svec, string_clone(s1));
+  result = result && libstring_alloc_stats(&during);
+  libstring_free(s1);
+  libstring_free(s2);
+  libstring_free(s3);
+  string_vector_deepfree(svec);
+  result = result && libstring_alloc_stats(&after);
+  libstring_set_allocator(NULL);
+
+  result = result && (during.live_bytes >= before.live_bytes + 11 + 6 + 5) &&
+           (during.peak_bytes >= during.live_bytes) &&
+           (after.live_bytes == before.live_bytes) &&
+           (after.frees - before.frees == 3 + 3 + 20 + 2) &&
+           alloc_count("string_concat") == n + 1 &&
+           alloc_count("(other)") == 0 &&
+           alloc_count("string_vector_resize") > 0 &&
+           !libstring_alloc_stats(&after);
+  verify_bool("allocator 1", string_new(""), NULL, result);
+}
+
+/**********************************************************************/
+
+static long fail_after; /* allocations until failing_malloc() fails */
+
+static void *failing_malloc(void *ctx, size_t size) {
+  (void)ctx;
+  if (__atomic_fetch_sub(&fail_after, 1, __ATOMIC_RELAXED) <= 0)
+    return NULL;
+  return malloc(size);
+}
+
+static void *failing_realloc(void *ctx, void *ptr, size_t size) {
+  (void)ctx;
+  if (__atomic_fetch_sub(&fail_after, 1, __ATOMIC_RELAXED) <= 0)
+    return NULL;
+  return realloc(ptr, size);
+}
+
+static void failing_free(void *ctx, void *ptr) {
+  (void)ctx;
+  free(ptr);
+}
+
+/*
+ * Lets every allocation of the parallel filter and reduce fail in turn,
+ * and checks that they fail cleanly without leaking memory.
+ */
+void test_allocator2() {
+  libstring_allocator_t failing = {failing_malloc, failing_realloc,
+                                   failing_free, NULL};
+  libstring_allocator_t counting = libstring_counting_allocator(&failing);
+  libstring_alloc_stats_t before, after;
+  fail_after = LONG_MAX;
+  libstring_set_allocator(&counting);
+  string_vector_t *svec = string_vector_empty();
+  for (size_t i = 0; i < 600; i++)
+    string_vector_add(svec, string_new((i % 50) ? "x" : "X"));
+  bool result = libstring_alloc_stats(&before), filtered = false;
+  bool reduced = false;
+
+  for (long n = 0; n < 1000 && !(filtered && reduced); n++) {
+    fail_after = n;
+    string_vector_t *f = string_vector_filter_parallel(strisupper, svec, 2);
+    fail_after = n;
+    string_t *r = string_vector_reduce_parallel(fold, svec, NULL, 2);
+    fail_after = LONG_MAX;
+    if (f != NULL) {
+      filtered = true;
+      result = result && string_vector_len(f) == 12;
+      string_vector_deepfree(f);
+    }
+    if (r != NULL) {
+      reduced = true;
+      result = result && string_len(r) == 600;
+      libstring_free(r);
+    }
+    result = result && libstring_alloc_stats(&after) &&
+             after.live_bytes == before.live_bytes;
+  }
+  string_vector_deepfree(svec);
+  libstring_set_allocator(NULL);
+  result = result && alloc_count("string_vector_filter_parallel") > 0 &&
+           alloc_count("string_vector_reduce_parallel") > 0 &&
+           alloc_count("filter_copy") == 0 && alloc_count("reduce_chunk") == 0;
+  verify_bool("allocator 2", string_new(""), NULL,
+              result && filtered && reduced);
+}
+
 /**********************************************************************/
 
 void string_vector_tests() {
@@ -745,11 +1833,20 @@ void string_vector_tests() {
   test_strvec_resize();
   test_strvec_find1();
   test_strvec_find2();
+  test_strvec_find3();
   test_strvec_remove1();
   test_strvec_remove2();
   test_strvec_remove3();
   test_strvec_map();
   test_strvec_filter();
+  test_strvec_swap_remove();
+  test_strvec_erase();
+  test_strvec_remove_if();
+  test_strvec_extend();
+  test_strvec_sort1();
+  test_strvec_sort2();
+  test_strvec_set1();
+  test_strvec_set2();
   test_strvec_split1();
   test_strvec_split2();
   test_strvec_split3();
@@ -757,8 +1854,25 @@ void string_vector_tests() {
   test_strvec_ssplit1();
   test_strvec_ssplit2();
   test_strvec_ssplit3();
+  test_strvec_ssplit4();
   test_strvec_reduce1();
   test_strvec_reduce2();
+  test_strvec_parallel();
+  test_matcher1();
+  test_matcher2();
+  test_view1();
+  test_view_split1();
+  test_split_iter1();
+  test_view_ssplit1();
+  test_arena1();
+  test_flatvec1();
+  test_flatvec2();
+  test_map1();
+  test_map2();
+  test_intern1();
+  test_intern2();
+  test_allocator1();
+  test_allocator2();
 }
 
 /**********************************************************************/